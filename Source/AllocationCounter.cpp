@@ -0,0 +1,97 @@
+//
+// COMP 371 Labs Framework
+//
+// Counts the heap allocations of every thread by replacing the global
+// operator new.
+//
+
+#include "AllocationCounter.h"
+
+#if ALLOCATION_COUNTER_ENABLED
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // plain data, so that it can be used before any constructor ran
+    thread_local uint64_t allocationCount = 0;
+
+    void* countedMalloc(size_t size)
+    {
+        ++allocationCount;
+        return malloc(size > 0 ? size : 1);
+    }
+
+    void* throwingMalloc(size_t size)
+    {
+        for (;;)
+        {
+            void* memory = countedMalloc(size);
+            if (memory != NULL)
+                return memory;
+            std::new_handler handler = std::get_new_handler();
+            if (handler == NULL)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+uint64_t threadAllocationCount()
+{
+    return allocationCount;
+}
+
+void* operator new(size_t size)
+{
+    return throwingMalloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    return throwingMalloc(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedMalloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return countedMalloc(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+// the sized versions of C++14, called instead of the ones above when the size is known
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    free(memory);
+}
+
+#endif
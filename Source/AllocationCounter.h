@@ -0,0 +1,34 @@
+//
+// COMP 371 Labs Framework
+//
+// Counts the heap allocations of every thread by replacing the global
+// operator new, so that the frame loop can check that it allocates nothing
+// once it has warmed up. Allocations made directly with malloc, like the GL
+// driver's, are not seen.
+//
+// Compiled in unless NDEBUG, like the profiler. Define
+// ALLOCATION_COUNTER_ENABLED=1 to check a release build.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#if !defined(ALLOCATION_COUNTER_ENABLED)
+#if defined(NDEBUG)
+#define ALLOCATION_COUNTER_ENABLED 0
+#else
+#define ALLOCATION_COUNTER_ENABLED 1
+#endif
+#endif
+
+#if ALLOCATION_COUNTER_ENABLED
+
+// operator new and new[] calls made by the calling thread since it started
+uint64_t threadAllocationCount();
+
+#else
+
+inline uint64_t threadAllocationCount() { return 0; }
+
+#endif
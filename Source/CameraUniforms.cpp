@@ -0,0 +1,77 @@
+//
+// COMP 371 Labs Framework
+//
+// Per-frame camera data in a std140 uniform buffer bound to a fixed binding
+// point. Every program that declares the Camera block reads it from there, so
+// the camera is uploaded once per frame whatever the number of programs.
+//
+
+#include "CameraUniforms.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+
+// std140 offsets: three mat4 of 64 bytes, then the vec3 and the float sharing 16 bytes
+static_assert(offsetof(CameraBlock, cameraPosition) == 192, "CameraBlock must match the std140 layout");
+static_assert(offsetof(CameraBlock, time) == 204, "CameraBlock must match the std140 layout");
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock must match the std140 layout");
+
+CameraUniformBuffer::CameraUniformBuffer()
+    : mBuffer(0), mUploaded(false)
+{
+    memset(&mBlock, 0, sizeof(mBlock));
+}
+
+CameraUniformBuffer::~CameraUniformBuffer()
+{
+    destroy();
+}
+
+bool CameraUniformBuffer::create()
+{
+    destroy();
+
+    glGenBuffers(1, &mBuffer);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    GLStateCache::bindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, mBuffer);
+    mUploaded = false;
+    return mBuffer != 0;
+}
+
+void CameraUniformBuffer::destroy()
+{
+    if (mBuffer == 0)
+        return;
+
+    GLStateCache::forgetBuffer(mBuffer);
+    glDeleteBuffers(1, &mBuffer);
+    mBuffer = 0;
+}
+
+void CameraUniformBuffer::update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3& cameraPosition, float time)
+{
+    CameraBlock block;
+    block.viewMatrix = viewMatrix;
+    block.projectionMatrix = projectionMatrix;
+    block.viewProjectionMatrix = projectionMatrix * viewMatrix;
+    block.cameraPosition = cameraPosition;
+    block.time = time;
+
+    if (mUploaded && memcmp(&block, &mBlock, sizeof(block)) == 0)
+    {
+        frameStats.uniformUploadsSkipped++;
+        return;
+    }
+
+    // the whole block is replaced, orphaning lets the driver skip the wait on the previous frame
+    mBlock = block;
+    mUploaded = true;
+    frameStats.uniformUploads++;
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &mBlock);
+}
@@ -0,0 +1,61 @@
+//
+// COMP 371 Labs Framework
+//
+// Per-frame camera data in a std140 uniform buffer bound to a fixed binding
+// point. Every program that declares the Camera block reads it from there, so
+// the camera is uploaded once per frame whatever the number of programs.
+//
+
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Binding point of the Camera block, shared by all programs
+const GLuint CAMERA_UNIFORM_BINDING = 0;
+const char* const CAMERA_UNIFORM_BLOCK = "Camera";
+
+// Mirrors the std140 layout of the block declared in the shaders:
+//
+// layout (std140) uniform Camera
+// {
+//     mat4 viewMatrix;
+//     mat4 projectionMatrix;
+//     mat4 viewProjectionMatrix;
+//     vec3 cameraPosition;
+//     float time;
+// };
+struct CameraBlock
+{
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::mat4 viewProjectionMatrix;
+    glm::vec3 cameraPosition;   // the vec3 is padded to 16 bytes, time fills the padding
+    float time;                 // seconds since startup
+};
+
+class CameraUniformBuffer
+{
+public:
+    CameraUniformBuffer();
+    ~CameraUniformBuffer();
+
+    // Allocates the buffer and binds it to CAMERA_UNIFORM_BINDING
+    bool create();
+    void destroy();
+
+    // Uploads the block, skipped when nothing changed since the last update
+    void update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3& cameraPosition, float time);
+
+    const CameraBlock& block() const { return mBlock; }
+
+private:
+    CameraUniformBuffer(const CameraUniformBuffer&);
+    CameraUniformBuffer& operator=(const CameraUniformBuffer&);
+
+    GLuint mBuffer;
+    CameraBlock mBlock;
+    bool mUploaded;
+};
@@ -0,0 +1,96 @@
+//
+// COMP 371 Labs Framework
+//
+// Draw commands recorded in any order and submitted in the order of their
+// 64-bit sort keys, sorted with an LSD radix sort, one byte per pass.
+//
+
+#include "DrawCommandBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "FrameArena.h"
+
+uint64_t makeDrawKey(unsigned int pass, unsigned int program, unsigned int vertexArray, unsigned int material, float depth)
+{
+    const uint64_t depthMax = (1u << DRAW_KEY_DEPTH_BITS) - 1;
+    uint64_t quantizedDepth = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * depthMax);
+
+    uint64_t key = pass & ((1u << DRAW_KEY_PASS_BITS) - 1);
+    key = (key << DRAW_KEY_PROGRAM_BITS) | (program & ((1u << DRAW_KEY_PROGRAM_BITS) - 1));
+    key = (key << DRAW_KEY_VERTEX_ARRAY_BITS) | (vertexArray & ((1u << DRAW_KEY_VERTEX_ARRAY_BITS) - 1));
+    key = (key << DRAW_KEY_MATERIAL_BITS) | (material & ((1u << DRAW_KEY_MATERIAL_BITS) - 1));
+    key = (key << DRAW_KEY_DEPTH_BITS) | quantizedDepth;
+    return key;
+}
+
+DrawCommandBuffer::DrawCommandBuffer()
+    : mCommands(NULL), mScratch(NULL), mCount(0), mCapacity(0), mSortPasses(0), mSortSeconds(0.0)
+{
+}
+
+void DrawCommandBuffer::reset(FrameArena& arena, size_t capacity)
+{
+    mCommands = arena.allocateArray<DrawCommand>(capacity);
+    mScratch = arena.allocateArray<DrawCommand>(capacity);
+    mCount = 0;
+    mCapacity = capacity;
+}
+
+bool DrawCommandBuffer::add(uint64_t key, unsigned int record)
+{
+    if (mCount == mCapacity)
+        return false;
+    mCommands[mCount].key = key;
+    mCommands[mCount].record = record;
+    ++mCount;
+    return true;
+}
+
+void DrawCommandBuffer::sort()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mSortPasses = 0;
+    size_t count = mCount;
+    if (count > 1)
+    {
+        // one histogram per key byte, all built in a single read of the keys
+        size_t histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t key = mCommands[i].key;
+            for (int byte = 0; byte < 8; ++byte)
+                histograms[byte][(key >> (8 * byte)) & 0xff]++;
+        }
+
+        DrawCommand* source = mCommands;
+        DrawCommand* destination = mScratch;
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            // the same value in every key: this byte leaves the order as it is
+            size_t* histogram = histograms[byte];
+            if (histogram[(source[0].key >> (8 * byte)) & 0xff] == count)
+                continue;
+
+            size_t offset = 0;
+            for (int value = 0; value < 256; ++value)
+            {
+                size_t valueCount = histogram[value];
+                histogram[value] = offset;
+                offset += valueCount;
+            }
+            for (size_t i = 0; i < count; ++i)
+                destination[histogram[(source[i].key >> (8 * byte)) & 0xff]++] = source[i];
+            std::swap(source, destination);
+            ++mSortPasses;
+        }
+
+        // an odd number of passes leaves the result in the scratch array
+        if (source != mCommands)
+            std::swap(mCommands, mScratch);
+    }
+    mSortSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
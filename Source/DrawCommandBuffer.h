@@ -0,0 +1,66 @@
+//
+// COMP 371 Labs Framework
+//
+// Draw commands recorded in any order and submitted in the order of their
+// 64-bit sort keys. The fields of a key go from the state that is the most
+// expensive to change down to the depth, so that after the sort draws with the
+// same program, vertex array and material are consecutive and, within them,
+// go front to back. Keys are sorted with an LSD radix sort, one byte per pass.
+// The commands live in a frame arena, so recording a frame does not allocate.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+class FrameArena;
+
+// Bits of the key fields, most significant first
+const unsigned int DRAW_KEY_PASS_BITS = 4;
+const unsigned int DRAW_KEY_PROGRAM_BITS = 8;
+const unsigned int DRAW_KEY_VERTEX_ARRAY_BITS = 8;
+const unsigned int DRAW_KEY_MATERIAL_BITS = 20;
+const unsigned int DRAW_KEY_DEPTH_BITS = 24;
+
+// pass | program | vertex array | material | depth. Ids are truncated to
+// their field, depth is a view distance in [0, 1] quantized to 24 bits.
+uint64_t makeDrawKey(unsigned int pass, unsigned int program, unsigned int vertexArray, unsigned int material, float depth);
+
+struct DrawCommand
+{
+    uint64_t key;
+    unsigned int record;    // index of the draw in the caller's own arrays
+};
+
+class DrawCommandBuffer
+{
+public:
+    DrawCommandBuffer();
+
+    // Forgets the commands and takes room for capacity new ones from the
+    // arena, valid until the arena is reset
+    void reset(FrameArena& arena, size_t capacity);
+
+    // false when the buffer is full
+    bool add(uint64_t key, unsigned int record);
+
+    // Stable sort by key. Bytes that are equal in every key, like the pass
+    // of a frame with a single pass, are not sorted on.
+    void sort();
+
+    size_t size() const { return mCount; }
+    const DrawCommand& operator[](size_t index) const { return mCommands[index]; }
+
+    // Cost of the last sort
+    int sortPasses() const { return mSortPasses; }
+    double sortSeconds() const { return mSortSeconds; }
+
+private:
+    DrawCommand* mCommands;
+    DrawCommand* mScratch;
+    size_t mCount;
+    size_t mCapacity;
+    int mSortPasses;
+    double mSortSeconds;
+};
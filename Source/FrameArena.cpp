@@ -0,0 +1,71 @@
+//
+// COMP 371 Labs Framework
+//
+// Linear allocator for the transient data of a frame. Allocations bump an
+// offset in one block and are all freed at once by reset().
+//
+
+#include "FrameArena.h"
+
+#include "AlignedAllocator.h"
+
+namespace
+{
+    const size_t BLOCK_ALIGNMENT = 64;
+}
+
+FrameArena::FrameArena(size_t capacity)
+    : mMemory(NULL), mCapacity(0), mOffset(0), mOverflowBytes(0)
+{
+    if (capacity > 0)
+    {
+        mMemory = static_cast<unsigned char*>(alignedMalloc(capacity, BLOCK_ALIGNMENT));
+        if (mMemory == NULL)
+            throw std::bad_alloc();
+        mCapacity = capacity;
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+    alignedFree(mMemory);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    size_t offset = (mOffset + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= mCapacity)
+    {
+        mOffset = offset + size;
+        return mMemory + offset;
+    }
+
+    // full: this allocation gets a block of its own until the next reset
+    void* memory = alignedMalloc(size > 0 ? size : 1, BLOCK_ALIGNMENT);
+    if (memory == NULL)
+        throw std::bad_alloc();
+    mOverflow.push_back(memory);
+    mOverflowBytes += size + alignment;
+    return memory;
+}
+
+void FrameArena::reset()
+{
+    if (!mOverflow.empty())
+    {
+        // one block for what the frame needed, with room to grow
+        size_t capacity = 2 * (mOffset + mOverflowBytes);
+        for (size_t i = 0; i < mOverflow.size(); ++i)
+            alignedFree(mOverflow[i]);
+        mOverflow.clear();
+        mOverflowBytes = 0;
+
+        alignedFree(mMemory);
+        mMemory = static_cast<unsigned char*>(alignedMalloc(capacity, BLOCK_ALIGNMENT));
+        if (mMemory == NULL)
+            throw std::bad_alloc();
+        mCapacity = capacity;
+    }
+    mOffset = 0;
+}
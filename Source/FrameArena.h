@@ -0,0 +1,54 @@
+//
+// COMP 371 Labs Framework
+//
+// Linear allocator for the transient data of a frame. Allocations bump an
+// offset in one block and are all freed at once by reset(); nothing is
+// destroyed, so only trivially destructible types go in. A frame that runs out
+// of space gets extra blocks from the heap, and the next reset() replaces them
+// with one block large enough for the whole frame, so after the first frames
+// the arena stops allocating.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t capacity = 64 * 1024);
+    ~FrameArena();
+
+    // size bytes aligned to alignment, a power of two up to 64, valid until reset()
+    void* allocate(size_t size, size_t alignment);
+
+    // count default-initialized objects, like new T[count] without the delete
+    template <typename T>
+    T* allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+        T* array = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < count; ++i)
+            new (&array[i]) T;
+        return array;
+    }
+
+    // Frees everything allocated since the last reset
+    void reset();
+
+    size_t bytesUsed() const { return mOffset + mOverflowBytes; }
+    size_t capacity() const { return mCapacity; }
+
+private:
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    unsigned char* mMemory;
+    size_t mCapacity;
+    size_t mOffset;
+    std::vector<void*> mOverflow;   // blocks of the allocations that did not fit
+    size_t mOverflowBytes;
+};
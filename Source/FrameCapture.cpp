@@ -0,0 +1,358 @@
+//
+// COMP 371 Labs Framework
+//
+// Screenshots and frame sequences without stalling the render loop. The
+// frame is resolved into a single-sample framebuffer and read into one of a
+// ring of pixel buffer objects behind a fence; a few frames later, once the
+// fence has signaled, the pixels are copied out and a pool of worker threads
+// encodes them to PNG or EXR with FreeImage.
+//
+
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if HAVE_FREEIMAGE
+#include <FreeImage.h>
+#endif
+
+#include "GLStateCache.h"
+
+namespace
+{
+    // glReadPixels layout of each format: BGRA bytes match FreeImage's
+    // 32-bit bitmaps, RGB floats match FIT_RGBF
+    GLsizeiptr bytesPerPixel(CaptureFormat format)
+    {
+        return (format == CAPTURE_EXR) ? 3 * sizeof(float) : 4;
+    }
+}
+
+const char* captureFileExtension(CaptureFormat format)
+{
+#if HAVE_FREEIMAGE
+    return (format == CAPTURE_EXR) ? ".exr" : ".png";
+#else
+    return (format == CAPTURE_EXR) ? ".pfm" : ".tga";
+#endif
+}
+
+FrameCapture::FrameCapture()
+    : mNextReadback(0), mFirstQueuedJob(0), mQueuedJobCount(0), mStopping(false), mDroppedFrames(0)
+{
+    for (unsigned int i = 0; i < READBACK_COUNT; ++i)
+    {
+        mReadbacks[i].pixelBuffer = 0;
+        mReadbacks[i].size = 0;
+        mReadbacks[i].fence = NULL;
+        mReadbacks[i].width = 0;
+        mReadbacks[i].height = 0;
+        mReadbacks[i].format = CAPTURE_PNG;
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    destroy();
+}
+
+bool FrameCapture::create(GLsizei width, GLsizei height, unsigned int workerCount)
+{
+    destroy();
+
+    if (!mResolveBuffer.create(width, height, 0))
+        return false;
+
+#if HAVE_FREEIMAGE
+    FreeImage_Initialise();
+#endif
+
+    for (unsigned int i = 0; i < READBACK_COUNT; ++i)
+    {
+        glGenBuffers(1, &mReadbacks[i].pixelBuffer);
+        mReadbacks[i].size = 0;
+        mReadbacks[i].fence = NULL;
+    }
+    mNextReadback = 0;
+
+    mFreeJobs.reserve(MAX_ENCODE_JOBS);
+    for (unsigned int i = 0; i < MAX_ENCODE_JOBS; ++i)
+    {
+        EncodeJob* job = new EncodeJob();
+        job->pixels.reserve(bytesPerPixel(CAPTURE_PNG) * width * height);
+        job->path.reserve(64);
+        mFreeJobs.push_back(job);
+    }
+    for (unsigned int i = 0; i < READBACK_COUNT; ++i)
+        mReadbacks[i].path.reserve(64);
+    mFirstQueuedJob = 0;
+    mQueuedJobCount = 0;
+
+    mStopping = false;
+    for (unsigned int i = 0; i < std::max(workerCount, 1u); ++i)
+        mWorkers.push_back(std::thread(&FrameCapture::encodeLoop, this));
+    return true;
+}
+
+void FrameCapture::destroy()
+{
+    if (mWorkers.empty())
+        return;
+
+    // oldest first, so that sequences are queued in order
+    bool allocated = false;
+    for (unsigned int i = 0; i < READBACK_COUNT; ++i)
+        finishReadback(mReadbacks[(mNextReadback + i) % READBACK_COUNT], true, allocated);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mJobQueued.notify_all();
+    for (size_t i = 0; i < mWorkers.size(); ++i)
+        mWorkers[i].join();
+    mWorkers.clear();
+
+    // the encoders are gone with the queue empty, every job is free
+    for (size_t i = 0; i < mFreeJobs.size(); ++i)
+        delete mFreeJobs[i];
+    mFreeJobs.clear();
+
+    for (unsigned int i = 0; i < READBACK_COUNT; ++i)
+    {
+        GLStateCache::forgetBuffer(mReadbacks[i].pixelBuffer);
+        glDeleteBuffers(1, &mReadbacks[i].pixelBuffer);
+        mReadbacks[i].pixelBuffer = 0;
+        mReadbacks[i].size = 0;
+    }
+    mResolveBuffer.destroy();
+#if HAVE_FREEIMAGE
+    FreeImage_DeInitialise();
+#endif
+}
+
+bool FrameCapture::capture(GLuint sourceFramebuffer, GLsizei width, GLsizei height, const std::string& path, CaptureFormat format)
+{
+    Readback& readback = mReadbacks[mNextReadback];
+    if (mWorkers.empty() || readback.fence != NULL || width <= 0 || height <= 0)
+    {
+        mDroppedFrames++;
+        return false;
+    }
+
+    // the window was resized, or its framebuffer is larger than its size (HiDPI):
+    // readbacks in flight are in their pixel buffers, the resolve buffer can go
+    if (width != mResolveBuffer.width() || height != mResolveBuffer.height())
+    {
+        if (!mResolveBuffer.create(width, height, 0))
+        {
+            std::cerr << "ERROR::CAPTURE::RESIZE_FAILED " << width << "x" << height << std::endl;
+            mDroppedFrames++;
+            return false;
+        }
+    }
+
+    // multisampled buffers can't be read directly, resolve into the single-sample copy
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mResolveBuffer.id());
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    GLsizeiptr size = bytesPerPixel(format) * width * height;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mResolveBuffer.id());
+    GLStateCache::bindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    if (readback.size != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        readback.size = size;
+    }
+    if (format == CAPTURE_EXR)
+        glReadPixels(0, 0, width, height, GL_RGB, GL_FLOAT, 0);
+    else
+        glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+    GLStateCache::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.width = width;
+    readback.height = height;
+    readback.path = path;
+    readback.format = format;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+    mNextReadback = (mNextReadback + 1) % READBACK_COUNT;
+    return true;
+}
+
+bool FrameCapture::update()
+{
+    // readbacks complete in order, stop at the first one still in flight
+    bool allocated = false;
+    for (unsigned int i = 0; i < READBACK_COUNT; ++i)
+    {
+        Readback& readback = mReadbacks[(mNextReadback + i) % READBACK_COUNT];
+        if (readback.fence != NULL && !finishReadback(readback, false, allocated))
+            break;
+    }
+    return allocated;
+}
+
+bool FrameCapture::finishReadback(Readback& readback, bool wait, bool& allocated)
+{
+    if (readback.fence == NULL)
+        return true;
+
+    GLuint64 timeout = wait ? 1000000000 : 0;   // nanoseconds
+    GLenum status = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    {
+        if (!wait)
+            return false;
+        std::cerr << "ERROR::CAPTURE::READBACK_TIMEOUT " << readback.path << std::endl;
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = NULL;
+
+    // a job from the pool, or a dropped frame when the encoders are that far behind
+    EncodeJob* job = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mFreeJobs.empty())
+        {
+            job = mFreeJobs.back();
+            mFreeJobs.pop_back();
+        }
+    }
+    if (job == NULL)
+    {
+        mDroppedFrames++;
+        return true;
+    }
+
+    GLStateCache::bindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.size, GL_MAP_READ_BIT);
+    bool mapped = (pixels != NULL);
+    if (mapped)
+    {
+        if ((size_t)readback.size > job->pixels.capacity())
+            allocated = true;
+        job->pixels.resize(readback.size);
+        memcpy(&job->pixels[0], pixels, readback.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    GLStateCache::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    job->width = readback.width;
+    job->height = readback.height;
+    if (readback.path.size() > job->path.capacity())
+        allocated = true;
+    job->path = readback.path;
+    job->format = readback.format;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mapped)
+            mQueuedJobs[(mFirstQueuedJob + mQueuedJobCount++) % MAX_ENCODE_JOBS] = job;
+        else
+            mFreeJobs.push_back(job);
+    }
+    if (mapped)
+        mJobQueued.notify_one();
+    else
+        std::cerr << "ERROR::CAPTURE::MAP_FAILED " << readback.path << std::endl;
+    return true;
+}
+
+void FrameCapture::encodeLoop()
+{
+    for (;;)
+    {
+        EncodeJob* job = NULL;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobQueued.wait(lock, [this]() { return mStopping || mQueuedJobCount > 0; });
+            if (mQueuedJobCount == 0)
+                return;     // stopping, and nothing left to encode
+            job = mQueuedJobs[mFirstQueuedJob];
+            mFirstQueuedJob = (mFirstQueuedJob + 1) % MAX_ENCODE_JOBS;
+            mQueuedJobCount--;
+        }
+
+        if (!encode(*job))
+            std::cerr << "ERROR::CAPTURE::SAVE_FAILED " << job->path << std::endl;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFreeJobs.push_back(job);
+    }
+}
+
+#if HAVE_FREEIMAGE
+bool FrameCapture::encode(const EncodeJob& job) const
+{
+    FIBITMAP* bitmap = NULL;
+    BOOL saved = FALSE;
+    if (job.format == CAPTURE_EXR)
+    {
+        // FreeImage rows are bottom-up like OpenGL's, but may be padded
+        bitmap = FreeImage_AllocateT(FIT_RGBF, job.width, job.height);
+        size_t rowSize = 3 * sizeof(float) * job.width;
+        for (GLsizei y = 0; bitmap != NULL && y < job.height; ++y)
+            memcpy(FreeImage_GetScanLine(bitmap, y), &job.pixels[y * rowSize], rowSize);
+        if (bitmap != NULL)
+            saved = FreeImage_Save(FIF_EXR, bitmap, job.path.c_str(), EXR_DEFAULT);
+    }
+    else
+    {
+        // the alpha channel is meaningless in a screenshot, saved as 24-bit
+        FIBITMAP* bgra = FreeImage_ConvertFromRawBits(const_cast<BYTE*>(&job.pixels[0]), job.width, job.height, 4 * job.width, 32,
+            FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, FALSE);
+        if (bgra != NULL)
+        {
+            bitmap = FreeImage_ConvertTo24Bits(bgra);
+            FreeImage_Unload(bgra);
+        }
+        if (bitmap != NULL)
+            saved = FreeImage_Save(FIF_PNG, bitmap, job.path.c_str(), PNG_Z_BEST_SPEED);
+    }
+
+    if (bitmap != NULL)
+        FreeImage_Unload(bitmap);
+    return saved == TRUE;
+}
+#else
+bool FrameCapture::encode(const EncodeJob& job) const
+{
+    std::ofstream file(job.path.c_str(), std::ios::out | std::ios::binary);
+    if (!file)
+        return false;
+
+    if (job.format == CAPTURE_EXR)
+    {
+        // PFM: rows bottom-up like OpenGL's, the negative scale means little-endian floats
+        file << "PF\n" << job.width << " " << job.height << "\n-1.0\n";
+        file.write((const char*)&job.pixels[0], 3 * sizeof(float) * job.width * job.height);
+    }
+    else
+    {
+        // TGA: uncompressed 24-bit BGR, origin at the bottom left like OpenGL's
+        unsigned char header[18] = {};
+        header[2] = 2;
+        header[12] = (unsigned char)(job.width & 0xff);
+        header[13] = (unsigned char)(job.width >> 8);
+        header[14] = (unsigned char)(job.height & 0xff);
+        header[15] = (unsigned char)(job.height >> 8);
+        header[16] = 24;
+        file.write((const char*)header, sizeof(header));
+
+        // the alpha channel is meaningless in a screenshot
+        std::vector<unsigned char> row(3 * job.width);
+        for (GLsizei y = 0; y < job.height; ++y)
+        {
+            const unsigned char* bgra = &job.pixels[4 * job.width * y];
+            for (GLsizei x = 0; x < job.width; ++x)
+                memcpy(&row[3 * x], &bgra[4 * x], 3);
+            file.write((const char*)&row[0], row.size());
+        }
+    }
+    return file.good();
+}
+#endif
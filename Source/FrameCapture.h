@@ -0,0 +1,114 @@
+//
+// COMP 371 Labs Framework
+//
+// Screenshots and frame sequences without stalling the render loop. The
+// frame is resolved into a single-sample framebuffer and read into one of a
+// ring of pixel buffer objects behind a fence; a few frames later, once the
+// fence has signaled, the pixels are copied out and a pool of worker threads
+// encodes them to PNG or EXR with FreeImage.
+//
+// FreeImage is not shipped with the framework. Define HAVE_FREEIMAGE=1 where
+// its header and library are installed; without it, frames are written
+// uncompressed, PNG captures as TGA and EXR captures as PFM.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "Framebuffer.h"
+
+#if !defined(HAVE_FREEIMAGE)
+#define HAVE_FREEIMAGE 0
+#endif
+
+enum CaptureFormat
+{
+    CAPTURE_PNG,    // 8 bits per channel
+    CAPTURE_EXR     // read back as floats, saved as half floats
+};
+
+// ".png" and ".exr", or ".tga" and ".pfm" without FreeImage
+const char* captureFileExtension(CaptureFormat format);
+
+class FrameCapture
+{
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Captures encoded by workerCount threads, width x height pixels until a
+    // capture of another size
+    bool create(GLsizei width, GLsizei height, unsigned int workerCount);
+
+    // Finishes the pending readbacks and waits for the encoders
+    void destroy();
+
+    // Queues a readback of the given framebuffer (0 for the window) of width x
+    // height pixels and binds it again. Fails, counting a dropped frame, when
+    // every pixel buffer is still in flight or too many frames wait for an encoder.
+    bool capture(GLuint sourceFramebuffer, GLsizei width, GLsizei height, const std::string& path, CaptureFormat format);
+
+    // Once per frame: hands the readbacks that completed to the encoders, never
+    // waits. Returns true when it had to allocate: a pixel buffer grew for a
+    // capture larger than the one create() sized them for, or for an EXR.
+    bool update();
+
+    unsigned int droppedFrames() const { return mDroppedFrames.load(); }
+
+private:
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator=(const FrameCapture&);
+
+    static const unsigned int READBACK_COUNT = 4;   // frames between a capture and its readback
+    static const unsigned int MAX_ENCODE_JOBS = 16; // frames waiting for or being encoded
+
+    struct Readback
+    {
+        GLuint pixelBuffer;
+        GLsizeiptr size;    // bytes allocated for pixelBuffer
+        GLsync fence;       // NULL when the readback is free
+        GLsizei width;
+        GLsizei height;
+        std::string path;
+        CaptureFormat format;
+    };
+
+    struct EncodeJob
+    {
+        std::vector<unsigned char> pixels;  // bottom row first, like glReadPixels
+        GLsizei width;
+        GLsizei height;
+        std::string path;
+        CaptureFormat format;
+    };
+
+    bool finishReadback(Readback& readback, bool wait, bool& allocated);
+    void encodeLoop();
+    bool encode(const EncodeJob& job) const;
+
+    Framebuffer mResolveBuffer;     // the size of the last capture
+    Readback mReadbacks[READBACK_COUNT];
+    unsigned int mNextReadback;     // also the oldest one in flight
+
+    std::vector<std::thread> mWorkers;  // empty until create()
+    std::mutex mMutex;                      // guards the members below
+    std::condition_variable mJobQueued;
+    // all MAX_ENCODE_JOBS jobs are made by create(), with the pixels of a PNG
+    // capture, so that handing frames to the encoders does not allocate
+    EncodeJob* mQueuedJobs[MAX_ENCODE_JOBS];    // ring, oldest at mFirstQueuedJob
+    unsigned int mFirstQueuedJob;
+    unsigned int mQueuedJobCount;
+    std::vector<EncodeJob*> mFreeJobs;
+    bool mStopping;
+
+    std::atomic<unsigned int> mDroppedFrames;
+};
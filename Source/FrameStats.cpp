@@ -0,0 +1,30 @@
+//
+// COMP 371 Labs Framework
+//
+// Per-frame rendering counters, used to compare the different render paths.
+//
+
+#include "FrameStats.h"
+
+FrameStats frameStats = {};
+
+void resetFrameStats()
+{
+    frameStats = FrameStats();
+}
+
+void printFrameStats(std::ostream& out, const FrameStats& stats, float frameTimeMs)
+{
+    out << "frame " << frameTimeMs << " ms"
+        << " | draw calls: " << stats.drawCalls
+        << " | instances: " << stats.instancesDrawn
+        << " | triangles: " << stats.trianglesSubmitted
+        << " | matrices: " << stats.matricesRecomputed
+        << " | uniforms: " << stats.uniformUploads << " issued, " << stats.uniformUploadsSkipped << " skipped"
+        << " | state: " << stats.stateChanges << " issued, " << stats.stateChangesSkipped << " skipped"
+        << " | culling: " << stats.objectsTested << " tested, " << stats.objectsCulled << " culled"
+        << " | streamed: " << stats.bytesStreamed << " bytes, " << stats.streamStalls << " stalls"
+        << " | sorted: " << stats.commandsSorted << " commands in " << stats.sortMicroseconds << " us"
+        << " | allocations: " << stats.allocations
+        << std::endl;
+}
@@ -0,0 +1,37 @@
+//
+// COMP 371 Labs Framework
+//
+// Per-frame rendering counters, used to compare the different render paths.
+//
+
+#pragma once
+
+#include <ostream>
+
+struct FrameStats
+{
+    int drawCalls;      // glDraw* calls issued this frame: direct, instanced and multi-draw indirect
+    int instancesDrawn; // cube instances submitted through instanced draws
+    int trianglesSubmitted; // triangles of the GL_TRIANGLES draws, lines and points are not counted
+    int matricesRecomputed; // local and world matrices recomposed by the transform hierarchy
+    int uniformUploads;     // glUniform* calls issued by ShaderProgram setters
+    int uniformUploadsSkipped; // setter calls dropped because the value was already uploaded
+    int stateChanges;       // binds and glEnable/glDisable issued by GLStateCache
+    int stateChangesSkipped;   // the ones dropped because GL was already in that state
+    int objectsTested;      // model and part bounding boxes tested against the view frustum
+    int objectsCulled;      // the ones outside, parts of a culled model are not tested
+    int bytesStreamed;      // allocated from StreamBuffer rings
+    int streamStalls;       // frames that waited for the GPU to release a StreamBuffer region
+    int commandsSorted;     // draw commands ordered by sort key before submission
+    float sortMicroseconds; // CPU time of that sort
+    int allocations;        // operator new calls of the main and render threads for this frame
+};
+
+// Counters of the frame currently being built
+extern FrameStats frameStats;
+
+// Clear all counters, called at the start of every frame
+void resetFrameStats();
+
+// Print the counters of the last completed frame on a single line
+void printFrameStats(std::ostream& out, const FrameStats& stats, float frameTimeMs);
@@ -0,0 +1,80 @@
+//
+// COMP 371 Labs Framework
+//
+// Framebuffer object with a color and a depth renderbuffer, the render
+// target of --headless where there is no window to draw into.
+//
+
+#include "Framebuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+Framebuffer::Framebuffer()
+    : mFramebuffer(0), mColorBuffer(0), mDepthBuffer(0), mWidth(0), mHeight(0), mSamples(0)
+{
+}
+
+Framebuffer::~Framebuffer()
+{
+    destroy();
+}
+
+void Framebuffer::destroy()
+{
+    if (mFramebuffer != 0)
+        glDeleteFramebuffers(1, &mFramebuffer);
+    if (mColorBuffer != 0)
+        glDeleteRenderbuffers(1, &mColorBuffer);
+    if (mDepthBuffer != 0)
+        glDeleteRenderbuffers(1, &mDepthBuffer);
+    mFramebuffer = 0;
+    mColorBuffer = 0;
+    mDepthBuffer = 0;
+    mWidth = 0;
+    mHeight = 0;
+    mSamples = 0;
+}
+
+bool Framebuffer::create(GLsizei width, GLsizei height, GLsizei samples)
+{
+    destroy();
+
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    samples = std::min(samples, (GLsizei)maxSamples);
+
+    glGenRenderbuffers(1, &mColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mColorBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &mDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "ERROR::FRAMEBUFFER::INCOMPLETE 0x" << std::hex << status << std::dec << std::endl;
+        destroy();
+        return false;
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mSamples = samples;
+    return true;
+}
+
+void Framebuffer::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glViewport(0, 0, mWidth, mHeight);
+}
@@ -0,0 +1,42 @@
+//
+// COMP 371 Labs Framework
+//
+// Framebuffer object with a color and a depth renderbuffer, the render
+// target of --headless where there is no window to draw into.
+//
+
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+class Framebuffer
+{
+public:
+    Framebuffer();
+    ~Framebuffer();
+
+    // RGBA8 color and 24-bit depth, multisampled when samples > 0. The sample
+    // count is clamped to what the driver supports. Replaces any previous buffers.
+    bool create(GLsizei width, GLsizei height, GLsizei samples);
+    void destroy();
+
+    // Draws to this framebuffer and sets the viewport to its size
+    void bind() const;
+
+    GLuint id() const { return mFramebuffer; }
+    GLsizei width() const { return mWidth; }
+    GLsizei height() const { return mHeight; }
+    GLsizei samples() const { return mSamples; }
+
+private:
+    Framebuffer(const Framebuffer&);
+    Framebuffer& operator=(const Framebuffer&);
+
+    GLuint mFramebuffer;
+    GLuint mColorBuffer;
+    GLuint mDepthBuffer;
+    GLsizei mWidth;
+    GLsizei mHeight;
+    GLsizei mSamples;
+};
@@ -0,0 +1,131 @@
+//
+// COMP 371 Labs Framework
+//
+// View-frustum culling. The six planes are extracted from projection * view
+// and tested against world space axis-aligned boxes, stored as
+// structure-of-arrays so that four boxes are tested per SSE iteration.
+//
+
+#include "Frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4& m)
+{
+    // Gribb & Hartmann: -w <= x, y, z <= w in clip space, row 3 +/- rows 0 to 2
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    for (int i = 0; i < 6; ++i)
+        frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+    return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3& center, const glm::vec3& extent) const
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        // distance of the center against the box's projected radius on the normal
+        const glm::vec4& plane = planes[i];
+        float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void transformBoundingBox(const glm::mat4& matrix, const glm::vec3& center, const glm::vec3& extent,
+    glm::vec3& outCenter, glm::vec3& outExtent)
+{
+    // Arvo: the new half sizes are the absolute rotation-scale part applied to the old ones
+    glm::mat3 linear(matrix);
+    outCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    outExtent = glm::abs(linear[0]) * extent.x + glm::abs(linear[1]) * extent.y + glm::abs(linear[2]) * extent.z;
+}
+
+void BoundingBoxSet::resize(size_t count)
+{
+    mCenterX.resize(count);
+    mCenterY.resize(count);
+    mCenterZ.resize(count);
+    mExtentX.resize(count);
+    mExtentY.resize(count);
+    mExtentZ.resize(count);
+}
+
+void BoundingBoxSet::set(size_t index, const glm::vec3& center, const glm::vec3& extent)
+{
+    mCenterX[index] = center.x;
+    mCenterY[index] = center.y;
+    mCenterZ[index] = center.z;
+    mExtentX[index] = extent.x;
+    mExtentY[index] = extent.y;
+    mExtentZ[index] = extent.z;
+}
+
+size_t BoundingBoxSet::cull(const Frustum& frustum, size_t begin, size_t end, unsigned char* visible) const
+{
+    size_t visibleCount = 0;
+    size_t i = begin;
+#if FRUSTUM_SSE
+    // plane components broadcast once, and their absolute values for the radius
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    __m128 absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+        absX[p] = _mm_and_ps(planeX[p], absMask);
+        absY[p] = _mm_and_ps(planeY[p], absMask);
+        absZ[p] = _mm_and_ps(planeZ[p], absMask);
+    }
+
+    // contiguous range: unaligned loads, begin may not be a multiple of 4
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&mCenterX[i]), cy = _mm_loadu_ps(&mCenterY[i]), cz = _mm_loadu_ps(&mCenterZ[i]);
+        __m128 ex = _mm_loadu_ps(&mExtentX[i]), ey = _mm_loadu_ps(&mExtentY[i]), ez = _mm_loadu_ps(&mExtentZ[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                                         _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        int outsideMask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            unsigned char inside = ((outsideMask >> lane) & 1) ? 0 : 1;
+            visible[i - begin + lane] = inside;
+            visibleCount += inside;
+        }
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        unsigned char inside = frustum.intersects(glm::vec3(mCenterX[i], mCenterY[i], mCenterZ[i]),
+                                                  glm::vec3(mExtentX[i], mExtentY[i], mExtentZ[i])) ? 1 : 0;
+        visible[i - begin] = inside;
+        visibleCount += inside;
+    }
+    return visibleCount;
+}
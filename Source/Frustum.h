@@ -0,0 +1,53 @@
+//
+// COMP 371 Labs Framework
+//
+// View-frustum culling. The six planes are extracted from projection * view
+// and tested against world space axis-aligned boxes, stored as
+// structure-of-arrays so that four boxes are tested per SSE iteration.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AlignedAllocator.h"
+
+struct Frustum
+{
+    // left, right, bottom, top, near, far: dot(plane, (p, 1)) >= 0 inside,
+    // normalized so that distances are in world units
+    glm::vec4 planes[6];
+
+    // Planes of the volume projectionMatrix * viewMatrix maps to clip space
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    // False when the box is entirely on the outer side of a plane. Boxes that
+    // cross two planes outside a corner are kept, the test is conservative.
+    bool intersects(const glm::vec3& center, const glm::vec3& extent) const;
+};
+
+// Axis-aligned box around the box (center, extent) transformed by matrix
+void transformBoundingBox(const glm::mat4& matrix, const glm::vec3& center, const glm::vec3& extent,
+    glm::vec3& outCenter, glm::vec3& outExtent);
+
+class BoundingBoxSet
+{
+public:
+    typedef std::vector<float, AlignedAllocator<float, 64> > FloatArray;
+
+    void resize(size_t count);
+    size_t size() const { return mCenterX.size(); }
+
+    // extent is the half size of the box on each axis
+    void set(size_t index, const glm::vec3& center, const glm::vec3& extent);
+
+    // visible[i - begin] is set to 1 for the boxes of [begin, end) that
+    // intersect the frustum, 0 for the others. Returns the visible count.
+    size_t cull(const Frustum& frustum, size_t begin, size_t end, unsigned char* visible) const;
+
+private:
+    FloatArray mCenterX, mCenterY, mCenterZ;
+    FloatArray mExtentX, mExtentY, mExtentZ;
+};
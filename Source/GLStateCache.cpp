@@ -0,0 +1,193 @@
+//
+// COMP 371 Labs Framework
+//
+// Shadow copy of the GL bindings and enable flags the framework changes:
+// current program, vertex array, buffer bindings and capabilities. Calls
+// that would set what is already set are dropped; both kinds are counted in
+// frameStats. All binds of these objects must go through the cache, and
+// objects must be forgotten before they are deleted since GL unbinds them.
+//
+
+#include "GLStateCache.h"
+
+#include "FrameStats.h"
+
+namespace
+{
+    // Binding values nothing can be equal to, until the first call sets them
+    const GLuint UNKNOWN_BINDING = ~0u;
+    enum { CAPABILITY_UNKNOWN = -1 };
+
+    const GLenum cachedBufferTargets[] = {
+        GL_ARRAY_BUFFER,
+        GL_ELEMENT_ARRAY_BUFFER,    // part of the vertex array state
+        GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER,
+        GL_UNIFORM_BUFFER,
+        GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER,
+        GL_DRAW_INDIRECT_BUFFER,
+        GL_SHADER_STORAGE_BUFFER,
+    };
+    const unsigned int BUFFER_TARGET_COUNT = sizeof(cachedBufferTargets) / sizeof(cachedBufferTargets[0]);
+
+    const GLenum cachedCapabilities[] = {
+        GL_CULL_FACE,
+        GL_DEPTH_TEST,
+        GL_MULTISAMPLE,
+        GL_BLEND,
+        GL_SCISSOR_TEST,
+        GL_STENCIL_TEST,
+        GL_POLYGON_OFFSET_FILL,
+        GL_PROGRAM_POINT_SIZE,
+    };
+    const unsigned int CAPABILITY_COUNT = sizeof(cachedCapabilities) / sizeof(cachedCapabilities[0]);
+
+    GLuint currentProgram = UNKNOWN_BINDING;
+    GLuint currentVertexArray = UNKNOWN_BINDING;
+    GLuint currentBuffers[BUFFER_TARGET_COUNT] = {
+        UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING,
+        UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING, UNKNOWN_BINDING
+    };
+    int capabilityStates[CAPABILITY_COUNT] = {
+        CAPABILITY_UNKNOWN, CAPABILITY_UNKNOWN, CAPABILITY_UNKNOWN, CAPABILITY_UNKNOWN,
+        CAPABILITY_UNKNOWN, CAPABILITY_UNKNOWN, CAPABILITY_UNKNOWN, CAPABILITY_UNKNOWN
+    };
+
+    // Slot of a target or capability in the arrays above, -1 when it is not cached
+    int findSlot(const GLenum* values, unsigned int count, GLenum value)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            if (values[i] == value)
+                return (int)i;
+        }
+        return -1;
+    }
+
+    // True when the call has to be issued, and counts it either way
+    bool changes(GLuint& current, GLuint value)
+    {
+        if (current == value)
+        {
+            frameStats.stateChangesSkipped++;
+            return false;
+        }
+        current = value;
+        frameStats.stateChanges++;
+        return true;
+    }
+
+    void setCapability(GLenum capability, bool enabled)
+    {
+        int slot = findSlot(cachedCapabilities, CAPABILITY_COUNT, capability);
+        if (slot >= 0)
+        {
+            if (capabilityStates[slot] == (int)enabled)
+            {
+                frameStats.stateChangesSkipped++;
+                return;
+            }
+            capabilityStates[slot] = (int)enabled;
+        }
+
+        frameStats.stateChanges++;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (changes(currentProgram, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+    if (!changes(currentVertexArray, vertexArray))
+        return;
+
+    glBindVertexArray(vertexArray);
+    // the element buffer binding comes with the vertex array
+    currentBuffers[findSlot(cachedBufferTargets, BUFFER_TARGET_COUNT, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN_BINDING;
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = findSlot(cachedBufferTargets, BUFFER_TARGET_COUNT, target);
+    if (slot < 0)
+    {
+        frameStats.stateChanges++;
+        glBindBuffer(target, buffer);
+    }
+    else if (changes(currentBuffers[slot], buffer))
+    {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    int slot = findSlot(cachedBufferTargets, BUFFER_TARGET_COUNT, target);
+    if (slot >= 0)
+        currentBuffers[slot] = buffer;
+    frameStats.stateChanges++;
+    glBindBufferBase(target, index, buffer);
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    int slot = findSlot(cachedBufferTargets, BUFFER_TARGET_COUNT, target);
+    if (slot >= 0)
+        currentBuffers[slot] = buffer;
+    frameStats.stateChanges++;
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLStateCache::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLStateCache::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLStateCache::forgetProgram(GLuint program)
+{
+    // a deleted program stays in use until another one is, it is simpler not to know
+    if (currentProgram == program)
+        currentProgram = UNKNOWN_BINDING;
+}
+
+void GLStateCache::forgetVertexArray(GLuint vertexArray)
+{
+    if (currentVertexArray == vertexArray)
+    {
+        currentVertexArray = 0;
+        currentBuffers[findSlot(cachedBufferTargets, BUFFER_TARGET_COUNT, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN_BINDING;
+    }
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer)
+{
+    for (unsigned int i = 0; i < BUFFER_TARGET_COUNT; ++i)
+    {
+        if (currentBuffers[i] == buffer)
+            currentBuffers[i] = 0;
+    }
+}
+
+void GLStateCache::invalidate()
+{
+    currentProgram = UNKNOWN_BINDING;
+    currentVertexArray = UNKNOWN_BINDING;
+    for (unsigned int i = 0; i < BUFFER_TARGET_COUNT; ++i)
+        currentBuffers[i] = UNKNOWN_BINDING;
+    for (unsigned int i = 0; i < CAPABILITY_COUNT; ++i)
+        capabilityStates[i] = CAPABILITY_UNKNOWN;
+}
@@ -0,0 +1,40 @@
+//
+// COMP 371 Labs Framework
+//
+// Shadow copy of the GL bindings and enable flags the framework changes:
+// current program, vertex array, buffer bindings and capabilities. Calls
+// that would set what is already set are dropped; both kinds are counted in
+// frameStats. All binds of these objects must go through the cache, and
+// objects must be forgotten before they are deleted since GL unbinds them.
+//
+// Uniform values are cached per program by ShaderProgram.
+//
+
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+class GLStateCache
+{
+public:
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vertexArray);
+    static void bindBuffer(GLenum target, GLuint buffer);
+    // glBindBufferBase, always issued; it also binds the buffer to the generic target
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    static void enable(GLenum capability);
+    static void disable(GLenum capability);
+
+    // Call before deleting an object, bindings to it are reset like GL does
+    static void forgetProgram(GLuint program);
+    static void forgetVertexArray(GLuint vertexArray);
+    static void forgetBuffer(GLuint buffer);
+
+    // Everything is unknown again, e.g. after a new context was made current
+    static void invalidate();
+
+private:
+    GLStateCache();
+};
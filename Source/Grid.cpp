@@ -0,0 +1,93 @@
+//
+// COMP 371 Labs Framework
+//
+// Ground grid built once into a vertex buffer of GL_LINES and drawn with a
+// single glDrawArrays call.
+//
+
+#include "Grid.h"
+
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+
+Grid::Grid()
+    : mVertexArrayObject(0), mVertexBufferObject(0), mVertexCount(0)
+{
+}
+
+Grid::~Grid()
+{
+    destroy();
+}
+
+void Grid::destroy()
+{
+    if (mVertexBufferObject != 0)
+    {
+        GLStateCache::forgetBuffer(mVertexBufferObject);
+        glDeleteBuffers(1, &mVertexBufferObject);
+    }
+    if (mVertexArrayObject != 0)
+    {
+        GLStateCache::forgetVertexArray(mVertexArrayObject);
+        glDeleteVertexArrays(1, &mVertexArrayObject);
+    }
+    mVertexBufferObject = 0;
+    mVertexArrayObject = 0;
+    mVertexCount = 0;
+}
+
+void Grid::create(float halfExtent, float spacing, float height)
+{
+    destroy();
+    if (halfExtent <= 0.0f || spacing <= 0.0f)
+        return;
+
+    // lines on both sides of the origin, the origin lines included
+    int linesPerSide = (int)std::floor(halfExtent / spacing);
+    std::vector<glm::vec3> vertices;
+    vertices.reserve(4 * (2 * linesPerSide + 1));
+    for (int i = -linesPerSide; i <= linesPerSide; ++i)
+    {
+        float offset = i * spacing;
+        vertices.push_back(glm::vec3(-halfExtent, height, offset));    // along X
+        vertices.push_back(glm::vec3(halfExtent, height, offset));
+        vertices.push_back(glm::vec3(offset, height, -halfExtent));    // along Z
+        vertices.push_back(glm::vec3(offset, height, halfExtent));
+    }
+    mVertexCount = (GLsizei)vertices.size();
+
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+
+    glGenBuffers(1, &mVertexBufferObject);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0,                   // attribute 0 matches aPos in Vertex Shader
+        3,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(glm::vec3),
+        (void*)0
+    );
+    glEnableVertexAttribArray(0);
+
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLStateCache::bindVertexArray(0);
+}
+
+void Grid::draw() const
+{
+    if (mVertexCount == 0)
+        return;
+
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+    glDrawArrays(GL_LINES, 0, mVertexCount);
+    frameStats.drawCalls++;
+}
@@ -0,0 +1,34 @@
+//
+// COMP 371 Labs Framework
+//
+// Ground grid built once into a vertex buffer of GL_LINES and drawn with a
+// single glDrawArrays call.
+//
+
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+class Grid
+{
+public:
+    Grid();
+    ~Grid();
+
+    // Lines every `spacing` units from -halfExtent to +halfExtent along X and Z,
+    // on the horizontal plane at the given height. Replaces any previous grid.
+    void create(float halfExtent, float spacing, float height);
+
+    // Binds the grid's vertex array and draws all the lines, uses the current program
+    void draw() const;
+
+    GLsizei vertexCount() const { return mVertexCount; }
+
+private:
+    void destroy();
+
+    GLuint mVertexArrayObject;
+    GLuint mVertexBufferObject;
+    GLsizei mVertexCount;
+};
@@ -0,0 +1,151 @@
+//
+// COMP 371 Labs Framework
+//
+// GPU-driven submission (GL 4.3). The world matrix and color of every cube
+// go into a shader storage buffer and each group of cubes becomes a draw
+// record of an indirect buffer, so a whole frame is one
+// glMultiDrawElementsIndirect call. The vertex shader finds its object
+// through a per-instance index attribute, which the draw record's base
+// instance offsets.
+//
+
+#include "IndirectRenderer.h"
+
+#include <cstring>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "StreamBuffer.h"
+
+IndirectRenderer::IndirectRenderer()
+    : mVertexArrayObject(0), mStream(NULL), mObjectIndexBuffer(0), mObjectIndexCapacity(0),
+      mStorageAlignment(256), mFirstObjectOfDraw(0)
+{
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+    if (mObjectIndexBuffer != 0)
+    {
+        GLStateCache::forgetBuffer(mObjectIndexBuffer);
+        glDeleteBuffers(1, &mObjectIndexBuffer);
+    }
+}
+
+bool IndirectRenderer::isSupported()
+{
+    return GLEW_VERSION_4_3 != 0;
+}
+
+void IndirectRenderer::initialize(GLuint vertexArrayObject, StreamBuffer& stream)
+{
+    mVertexArrayObject = vertexArrayObject;
+    mStream = &stream;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &mStorageAlignment);
+
+    glGenBuffers(1, &mObjectIndexBuffer);
+    reserveObjectIndices(1024);
+
+    // an integer attribute advancing once per instance: the base instance of a
+    // draw record is added to it, so instance i of the record reads object baseInstance + i
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, mObjectIndexBuffer);
+    glVertexAttribIPointer(OBJECT_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glEnableVertexAttribArray(OBJECT_INDEX_LOCATION);
+    glVertexAttribDivisor(OBJECT_INDEX_LOCATION, 1);
+
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLStateCache::bindVertexArray(0);
+}
+
+void IndirectRenderer::reserveObjectIndices(size_t count)
+{
+    if (count <= mObjectIndexCapacity)
+        return;
+
+    // the attribute points at the buffer object, not its storage: no need to set it again
+    while (mObjectIndexCapacity < count)
+        mObjectIndexCapacity = (mObjectIndexCapacity == 0) ? 1024 : mObjectIndexCapacity * 2;
+    std::vector<GLuint> indices(mObjectIndexCapacity);
+    for (size_t i = 0; i < indices.size(); ++i)
+        indices[i] = (GLuint)i;
+
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, mObjectIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+}
+
+void IndirectRenderer::reserve(size_t objects)
+{
+    // at worst every object is a draw record of its own
+    mObjects.reserve(objects);
+    mCommands.reserve(objects);
+    reserveObjectIndices(objects);
+}
+
+void IndirectRenderer::begin()
+{
+    mObjects.clear();
+    mCommands.clear();
+    mFirstObjectOfDraw = 0;
+}
+
+void IndirectRenderer::add(const glm::mat4& worldMatrix, const glm::vec3& color)
+{
+    ObjectData object;
+    object.worldMatrix = worldMatrix;
+    object.color = glm::vec4(color, 1.0f);
+    mObjects.push_back(object);
+}
+
+void IndirectRenderer::endDraw()
+{
+    if (mObjects.size() == mFirstObjectOfDraw)
+        return;
+
+    // the mesh fields are filled by draw(), every record uses the whole mesh for now
+    DrawElementsIndirectCommand command;
+    command.count = 0;
+    command.instanceCount = (GLuint)(mObjects.size() - mFirstObjectOfDraw);
+    command.firstIndex = 0;
+    command.baseVertex = 0;
+    command.baseInstance = (GLuint)mFirstObjectOfDraw;
+    mCommands.push_back(command);
+    mFirstObjectOfDraw = mObjects.size();
+}
+
+bool IndirectRenderer::draw(GLenum mode, GLsizei indexCount, GLenum indexType)
+{
+    endDraw();
+    if (mCommands.empty())
+        return true;
+
+    for (size_t i = 0; i < mCommands.size(); ++i)
+        mCommands[i].count = (GLuint)indexCount;
+
+    size_t objectsSize = mObjects.size() * sizeof(ObjectData);
+    size_t commandsSize = mCommands.size() * sizeof(DrawElementsIndirectCommand);
+    size_t objectsOffset = 0, commandsOffset = 0;
+    void* objects = mStream->allocate(objectsSize, (size_t)mStorageAlignment, objectsOffset);
+    if (objects == NULL)
+        return false;
+    memcpy(objects, &mObjects[0], objectsSize);
+    mStream->commit();
+    void* commands = mStream->allocate(commandsSize, sizeof(GLuint), commandsOffset);
+    if (commands == NULL)
+        return false;
+    memcpy(commands, &mCommands[0], commandsSize);
+    mStream->commit();
+
+    reserveObjectIndices(mObjects.size());
+
+    GLStateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, OBJECT_STORAGE_BINDING, mStream->buffer(), objectsOffset, objectsSize);
+    GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, mStream->buffer());
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+    glMultiDrawElementsIndirect(mode, indexType, (void*)commandsOffset, (GLsizei)mCommands.size(), 0);
+
+    frameStats.drawCalls++;
+    frameStats.instancesDrawn += (int)mObjects.size();
+    if (mode == GL_TRIANGLES)
+        frameStats.trianglesSubmitted += (int)mObjects.size() * (indexCount / 3);
+    return true;
+}
@@ -0,0 +1,89 @@
+//
+// COMP 371 Labs Framework
+//
+// GPU-driven submission (GL 4.3). The world matrix and color of every cube
+// go into a shader storage buffer and each group of cubes becomes a draw
+// record of an indirect buffer, so a whole frame is one
+// glMultiDrawElementsIndirect call. The vertex shader finds its object
+// through a per-instance index attribute, which the draw record's base
+// instance offsets.
+//
+
+#pragma once
+
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+class StreamBuffer;
+
+// Vertex attribute of the object index, 0 to 7 are used by the mesh and the instanced path
+const GLuint OBJECT_INDEX_LOCATION = 8;
+// Shader storage binding of the object array
+const GLuint OBJECT_STORAGE_BINDING = 0;
+
+// std430 layout of the Objects buffer in IndirectVertexShader.glsl
+struct ObjectData
+{
+    glm::mat4 worldMatrix;
+    glm::vec4 color;        // rgb, a unused
+};
+
+// Layout defined by GL for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class IndirectRenderer
+{
+public:
+    IndirectRenderer();
+    ~IndirectRenderer();
+
+    // True for GL 4.3 contexts: multi-draw indirect, storage buffers and base instance
+    static bool isSupported();
+
+    // Attaches the object index attribute to the given vertex array object.
+    // The objects and draw records of each frame are allocated from stream.
+    void initialize(GLuint vertexArrayObject, StreamBuffer& stream);
+
+    // Room for that many objects per frame, so that add() and draw() do not allocate
+    void reserve(size_t objects);
+
+    void begin();
+    void add(const glm::mat4& worldMatrix, const glm::vec3& color);
+    // Closes the draw record of the objects added since the previous one,
+    // e.g. at the end of a model. Nothing is recorded when no object was added.
+    void endDraw();
+
+    // Uploads objects and draw records, then submits them in one call.
+    // Returns false when they don't fit in the stream, nothing is drawn then.
+    bool draw(GLenum mode, GLsizei indexCount, GLenum indexType);
+
+    size_t objectCount() const { return mObjects.size(); }
+    size_t drawCount() const { return mCommands.size(); }
+
+private:
+    IndirectRenderer(const IndirectRenderer&);
+    IndirectRenderer& operator=(const IndirectRenderer&);
+
+    // Makes the object index buffer hold 0 to count - 1
+    void reserveObjectIndices(size_t count);
+
+    GLuint mVertexArrayObject;
+    StreamBuffer* mStream;
+    GLuint mObjectIndexBuffer;
+    size_t mObjectIndexCapacity;
+    GLint mStorageAlignment;        // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+    size_t mFirstObjectOfDraw;      // objects before it belong to closed draw records
+    std::vector<ObjectData> mObjects;
+    std::vector<DrawElementsIndirectCommand> mCommands;
+};
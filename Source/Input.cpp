@@ -0,0 +1,191 @@
+//
+// COMP 371 Labs Framework
+//
+// Event-driven keyboard and mouse input. GLFW callbacks record key and
+// button state plus the press/release edges of the current frame in
+// bitsets; a table of bindings maps them to actions that the frame loop
+// queries in O(1) instead of polling glfwGetKey for every key.
+//
+
+#include "Input.h"
+
+#include <GLFW/glfw3.h>
+
+static_assert(GLFW_KEY_LAST < INPUT_KEY_COUNT, "INPUT_KEY_COUNT too small");
+static_assert(GLFW_MOUSE_BUTTON_LAST < INPUT_MOUSE_BUTTON_COUNT, "INPUT_MOUSE_BUTTON_COUNT too small");
+
+Input::Input()
+    : mCursorX(0.0), mCursorY(0.0)
+{
+}
+
+void Input::attach(GLFWwindow* window)
+{
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, &Input::onKey);
+    glfwSetMouseButtonCallback(window, &Input::onMouseButton);
+    glfwSetCursorPosCallback(window, &Input::onCursorPosition);
+    glfwSetInputMode(window, GLFW_LOCK_KEY_MODS, GLFW_TRUE);
+    glfwGetCursorPos(window, &mCursorX, &mCursorY);
+
+    bindDefaults();
+}
+
+void Input::clearBindings()
+{
+    mBindings.clear();
+}
+
+void Input::bindKey(InputAction action, int key, InputModifier modifier)
+{
+    if (key < 0 || key >= INPUT_KEY_COUNT)
+        return;
+
+    Binding binding = { action, key, false, modifier };
+    mBindings.push_back(binding);
+}
+
+void Input::bindMouseButton(InputAction action, int button)
+{
+    if (button < 0 || button >= INPUT_MOUSE_BUTTON_COUNT)
+        return;
+
+    Binding binding = { action, button, true, MODIFIER_ANY };
+    mBindings.push_back(binding);
+}
+
+// The keys described in README.txt
+void Input::bindDefaults()
+{
+    clearBindings();
+
+    bindKey(ACTION_QUIT, GLFW_KEY_ESCAPE);
+    bindKey(ACTION_TOGGLE_INSTANCING, GLFW_KEY_F1);
+    bindKey(ACTION_TOGGLE_FRAME_STATS, GLFW_KEY_F2);
+    bindKey(ACTION_WRITE_PROFILE, GLFW_KEY_F3);
+    bindKey(ACTION_TOGGLE_CULLING, GLFW_KEY_F4);
+    bindKey(ACTION_SCREENSHOT, GLFW_KEY_F12, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_SCREENSHOT_EXR, GLFW_KEY_F12, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_TOGGLE_RECORDING, GLFW_KEY_F11);
+
+    bindKey(ACTION_MODEL_STEP_LEFT, GLFW_KEY_A, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_STEP_RIGHT, GLFW_KEY_D, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_SPIN_LEFT, GLFW_KEY_Z, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_SPIN_RIGHT, GLFW_KEY_C, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_TILT_UP, GLFW_KEY_W, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_TILT_DOWN, GLFW_KEY_S, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_MOVE_LEFT, GLFW_KEY_A, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_MOVE_RIGHT, GLFW_KEY_D, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_MOVE_UP, GLFW_KEY_W, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_MOVE_DOWN, GLFW_KEY_S, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_SCALE_UP, GLFW_KEY_U, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_MODEL_SCALE_DOWN, GLFW_KEY_J, MODIFIER_LEFT_SHIFT);
+    for (int n = 0; n < 9; ++n)
+        bindKey((InputAction)(ACTION_SELECT_MODEL_1 + n), GLFW_KEY_1 + n);
+    bindKey(ACTION_DESELECT_MODEL, GLFW_KEY_0);
+
+    bindKey(ACTION_CAMERA_LEFT, GLFW_KEY_J, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_CAMERA_RIGHT, GLFW_KEY_L, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_CAMERA_FORWARD, GLFW_KEY_I, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_CAMERA_BACKWARD, GLFW_KEY_K, MODIFIER_NO_LEFT_SHIFT);
+    bindKey(ACTION_CAMERA_UP, GLFW_KEY_LEFT_BRACKET);
+    bindKey(ACTION_CAMERA_DOWN, GLFW_KEY_RIGHT_BRACKET);
+    bindKey(ACTION_CAMERA_FAST, GLFW_KEY_RIGHT_SHIFT);
+    bindKey(ACTION_CAMERA_RESET, GLFW_KEY_O);
+    bindMouseButton(ACTION_CAMERA_PAN, GLFW_MOUSE_BUTTON_LEFT);
+    bindMouseButton(ACTION_CAMERA_ZOOM, GLFW_MOUSE_BUTTON_RIGHT);
+
+    bindKey(ACTION_WORLD_ROTATE_LEFT, GLFW_KEY_LEFT);
+    bindKey(ACTION_WORLD_ROTATE_RIGHT, GLFW_KEY_RIGHT);
+    bindKey(ACTION_WORLD_ROTATE_UP, GLFW_KEY_UP);
+    bindKey(ACTION_WORLD_ROTATE_DOWN, GLFW_KEY_DOWN);
+    bindKey(ACTION_WORLD_RESET, GLFW_KEY_HOME);
+
+    bindKey(ACTION_DRAW_TRIANGLES, GLFW_KEY_T, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_DRAW_LINES, GLFW_KEY_L, MODIFIER_LEFT_SHIFT);
+    bindKey(ACTION_DRAW_POINTS, GLFW_KEY_P, MODIFIER_LEFT_SHIFT);
+}
+
+void Input::poll()
+{
+    mKeysPressed.reset();
+    mKeysReleased.reset();
+    mButtonsPressed.reset();
+    mButtonsReleased.reset();
+
+    glfwPollEvents();
+
+    evaluateBindings();
+}
+
+void Input::evaluateBindings()
+{
+    mActionDown.reset();
+    mActionPressed.reset();
+    mActionReleased.reset();
+
+    bool leftShift = mKeysDown[GLFW_KEY_LEFT_SHIFT];
+    for (size_t i = 0; i < mBindings.size(); ++i)
+    {
+        const Binding& binding = mBindings[i];
+        if ((binding.modifier == MODIFIER_LEFT_SHIFT && !leftShift) || (binding.modifier == MODIFIER_NO_LEFT_SHIFT && leftShift))
+            continue;
+
+        bool down = binding.mouseButton ? mButtonsDown[binding.code] : mKeysDown[binding.code];
+        bool pressed = binding.mouseButton ? mButtonsPressed[binding.code] : mKeysPressed[binding.code];
+        bool released = binding.mouseButton ? mButtonsReleased[binding.code] : mKeysReleased[binding.code];
+        if (down)
+            mActionDown.set(binding.action);
+        if (pressed)
+            mActionPressed.set(binding.action);
+        if (released)
+            mActionReleased.set(binding.action);
+    }
+}
+
+void Input::onKey(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/)
+{
+    Input* input = static_cast<Input*>(glfwGetWindowUserPointer(window));
+    if (input == NULL || key < 0 || key >= INPUT_KEY_COUNT || action == GLFW_REPEAT)
+        return;
+
+    // a press and a release can both land in the same frame, keep both edges
+    if (action == GLFW_PRESS)
+    {
+        input->mKeysDown.set(key);
+        input->mKeysPressed.set(key);
+    }
+    else
+    {
+        input->mKeysDown.reset(key);
+        input->mKeysReleased.set(key);
+    }
+}
+
+void Input::onMouseButton(GLFWwindow* window, int button, int action, int /*mods*/)
+{
+    Input* input = static_cast<Input*>(glfwGetWindowUserPointer(window));
+    if (input == NULL || button < 0 || button >= INPUT_MOUSE_BUTTON_COUNT)
+        return;
+
+    if (action == GLFW_PRESS)
+    {
+        input->mButtonsDown.set(button);
+        input->mButtonsPressed.set(button);
+    }
+    else
+    {
+        input->mButtonsDown.reset(button);
+        input->mButtonsReleased.set(button);
+    }
+}
+
+void Input::onCursorPosition(GLFWwindow* window, double x, double y)
+{
+    Input* input = static_cast<Input*>(glfwGetWindowUserPointer(window));
+    if (input == NULL)
+        return;
+
+    input->mCursorX = x;
+    input->mCursorY = y;
+}
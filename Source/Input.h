@@ -0,0 +1,137 @@
+//
+// COMP 371 Labs Framework
+//
+// Event-driven keyboard and mouse input. GLFW callbacks record key and
+// button state plus the press/release edges of the current frame in
+// bitsets; a table of bindings maps them to actions that the frame loop
+// queries in O(1) instead of polling glfwGetKey for every key.
+//
+
+#pragma once
+
+#include <bitset>
+#include <vector>
+
+struct GLFWwindow;
+
+enum InputAction
+{
+    ACTION_QUIT,
+    ACTION_TOGGLE_INSTANCING,
+    ACTION_TOGGLE_FRAME_STATS,
+    ACTION_TOGGLE_CULLING,
+    ACTION_WRITE_PROFILE,
+    ACTION_SCREENSHOT,
+    ACTION_SCREENSHOT_EXR,
+    ACTION_TOGGLE_RECORDING,
+
+    // selected model
+    ACTION_MODEL_STEP_LEFT,     // 5 degree steps around y
+    ACTION_MODEL_STEP_RIGHT,
+    ACTION_MODEL_SPIN_LEFT,     // continuous rotation around y
+    ACTION_MODEL_SPIN_RIGHT,
+    ACTION_MODEL_TILT_UP,       // continuous rotation around x
+    ACTION_MODEL_TILT_DOWN,
+    ACTION_MODEL_MOVE_LEFT,
+    ACTION_MODEL_MOVE_RIGHT,
+    ACTION_MODEL_MOVE_UP,
+    ACTION_MODEL_MOVE_DOWN,
+    ACTION_MODEL_SCALE_UP,
+    ACTION_MODEL_SCALE_DOWN,
+    ACTION_SELECT_MODEL_1,      // followed by the actions of models 2 to 9
+    ACTION_SELECT_MODEL_9 = ACTION_SELECT_MODEL_1 + 8,
+    ACTION_DESELECT_MODEL,
+
+    // camera
+    ACTION_CAMERA_LEFT,
+    ACTION_CAMERA_RIGHT,
+    ACTION_CAMERA_FORWARD,
+    ACTION_CAMERA_BACKWARD,
+    ACTION_CAMERA_UP,
+    ACTION_CAMERA_DOWN,
+    ACTION_CAMERA_FAST,
+    ACTION_CAMERA_RESET,
+    ACTION_CAMERA_PAN,          // mouse drag
+    ACTION_CAMERA_ZOOM,
+
+    // world
+    ACTION_WORLD_ROTATE_LEFT,
+    ACTION_WORLD_ROTATE_RIGHT,
+    ACTION_WORLD_ROTATE_UP,
+    ACTION_WORLD_ROTATE_DOWN,
+    ACTION_WORLD_RESET,
+
+    ACTION_DRAW_TRIANGLES,
+    ACTION_DRAW_LINES,
+    ACTION_DRAW_POINTS,
+
+    ACTION_COUNT
+};
+
+// Left shift state required by a key binding. The letter keys do different
+// things with and without the left shift, the right shift is free for ACTION_CAMERA_FAST.
+enum InputModifier
+{
+    MODIFIER_ANY,
+    MODIFIER_NO_LEFT_SHIFT,
+    MODIFIER_LEFT_SHIFT
+};
+
+const int INPUT_KEY_COUNT = 512;        // > GLFW_KEY_LAST
+const int INPUT_MOUSE_BUTTON_COUNT = 8; // GLFW_MOUSE_BUTTON_LAST + 1
+
+class Input
+{
+public:
+    Input();
+
+    // Installs the callbacks on the window and loads the default bindings
+    void attach(GLFWwindow* window);
+
+    void clearBindings();
+    void bindKey(InputAction action, int key, InputModifier modifier = MODIFIER_ANY);
+    void bindMouseButton(InputAction action, int button);
+
+    // Clears the edges of the last frame, processes the pending window events
+    // (replaces glfwPollEvents) and evaluates the bindings
+    void poll();
+
+    bool isDown(InputAction action) const { return mActionDown[action]; }
+    bool wasPressed(InputAction action) const { return mActionPressed[action]; }
+    bool wasReleased(InputAction action) const { return mActionReleased[action]; }
+
+    double cursorX() const { return mCursorX; }
+    double cursorY() const { return mCursorY; }
+
+private:
+    struct Binding
+    {
+        InputAction action;
+        int code;       // GLFW key or mouse button
+        bool mouseButton;
+        InputModifier modifier;
+    };
+
+    static void onKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void onMouseButton(GLFWwindow* window, int button, int action, int mods);
+    static void onCursorPosition(GLFWwindow* window, double x, double y);
+
+    void bindDefaults();
+    void evaluateBindings();
+
+    std::vector<Binding> mBindings;
+
+    std::bitset<INPUT_KEY_COUNT> mKeysDown;
+    std::bitset<INPUT_KEY_COUNT> mKeysPressed;      // edges since the last poll()
+    std::bitset<INPUT_KEY_COUNT> mKeysReleased;
+    std::bitset<INPUT_MOUSE_BUTTON_COUNT> mButtonsDown;
+    std::bitset<INPUT_MOUSE_BUTTON_COUNT> mButtonsPressed;
+    std::bitset<INPUT_MOUSE_BUTTON_COUNT> mButtonsReleased;
+
+    std::bitset<ACTION_COUNT> mActionDown;
+    std::bitset<ACTION_COUNT> mActionPressed;
+    std::bitset<ACTION_COUNT> mActionReleased;
+
+    double mCursorX;
+    double mCursorY;
+};
@@ -0,0 +1,155 @@
+//
+// COMP 371 Labs Framework
+//
+// Collects the world matrix and color of every cube drawn in a frame and
+// submits them all with a single glDrawElementsInstanced call. The instances
+// are written to a StreamBuffer when one is given, otherwise to a buffer of
+// their own that is orphaned every frame.
+//
+
+#include "InstancedRenderer.h"
+
+#include <cstring>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "StreamBuffer.h"
+
+InstancedRenderer::InstancedRenderer()
+    : mVertexArrayObject(0), mStream(NULL), mInstanceBufferObject(0), mCapacity(0), mAttributeBuffer(0), mAttributeOffset(0)
+{
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+    if (mInstanceBufferObject != 0)
+    {
+        GLStateCache::forgetBuffer(mInstanceBufferObject);
+        glDeleteBuffers(1, &mInstanceBufferObject);
+    }
+}
+
+// The 3.2 core context on OSX only exposes the ARB entry point
+static void setAttributeDivisor(GLuint location, GLuint divisor)
+{
+    if (GLEW_VERSION_3_3)
+        glVertexAttribDivisor(location, divisor);
+    else
+        glVertexAttribDivisorARB(location, divisor);
+}
+
+bool InstancedRenderer::isSupported()
+{
+    return GLEW_VERSION_3_3 || (GLEW_VERSION_3_1 && GLEW_ARB_instanced_arrays);
+}
+
+void InstancedRenderer::initialize(GLuint vertexArrayObject, StreamBuffer* stream)
+{
+    mVertexArrayObject = vertexArrayObject;
+    mStream = stream;
+
+    // the attributes start on the renderer's own buffer, draws move them to the stream
+    glGenBuffers(1, &mInstanceBufferObject);
+    setInstanceAttributes(mInstanceBufferObject, 0);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+        setAttributeDivisor(INSTANCE_MATRIX_LOCATION + column, 1);
+    }
+    glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+    setAttributeDivisor(INSTANCE_COLOR_LOCATION, 1);
+
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLStateCache::bindVertexArray(0);
+}
+
+void InstancedRenderer::setInstanceAttributes(GLuint buffer, size_t offset)
+{
+    if (buffer == mAttributeBuffer && offset == mAttributeOffset)
+        return;
+    mAttributeBuffer = buffer;
+    mAttributeOffset = offset;
+
+    // the vertex array records the buffer bound when each pointer is set
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // a mat4 attribute is passed as 4 vec4 columns, each advancing once per instance
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + column,
+            4,
+            GL_FLOAT,
+            GL_FALSE,
+            sizeof(InstanceData),
+            (void*)(offset + column * sizeof(glm::vec4))
+        );
+    }
+
+    glVertexAttribPointer(INSTANCE_COLOR_LOCATION,
+        3,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(InstanceData),
+        (void*)(offset + sizeof(glm::mat4))      // color comes after the world matrix
+    );
+}
+
+void InstancedRenderer::reserve(size_t instances)
+{
+    mInstances.reserve(instances);
+}
+
+void InstancedRenderer::begin()
+{
+    mInstances.clear();
+}
+
+void InstancedRenderer::add(const glm::mat4& worldMatrix, const glm::vec3& color)
+{
+    InstanceData instance;
+    instance.worldMatrix = worldMatrix;
+    instance.color = color;
+    mInstances.push_back(instance);
+}
+
+void InstancedRenderer::draw(GLenum mode, GLsizei indexCount, GLenum indexType)
+{
+    if (mInstances.empty())
+        return;
+
+    size_t size = mInstances.size() * sizeof(InstanceData);
+    size_t offset = 0;
+    void* data = (mStream != NULL) ? mStream->allocate(size, sizeof(glm::vec4), offset) : NULL;
+    if (data != NULL)
+    {
+        // written straight to memory the GPU reads, no copy in the driver
+        memcpy(data, &mInstances[0], size);
+        mStream->commit();
+        setInstanceAttributes(mStream->buffer(), offset);
+    }
+    else
+    {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, mInstanceBufferObject);
+
+        if (mInstances.size() > mCapacity)
+        {
+            // grow geometrically so the buffer is only reallocated a handful of times
+            while (mCapacity < mInstances.size())
+                mCapacity = (mCapacity == 0) ? 64 : mCapacity * 2;
+        }
+
+        // orphan the previous contents so the driver does not wait on last frame's draw
+        glBufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, &mInstances[0]);
+        setInstanceAttributes(mInstanceBufferObject, 0);
+    }
+
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+    glDrawElementsInstanced(mode, indexCount, indexType, 0, (GLsizei)mInstances.size());
+
+    frameStats.drawCalls++;
+    frameStats.instancesDrawn += (int)mInstances.size();
+    if (mode == GL_TRIANGLES)
+        frameStats.trianglesSubmitted += (int)mInstances.size() * (indexCount / 3);
+}
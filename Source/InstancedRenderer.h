@@ -0,0 +1,66 @@
+//
+// COMP 371 Labs Framework
+//
+// Collects the world matrix and color of every cube drawn in a frame and
+// submits them all with a single glDrawElementsInstanced call. The instances
+// are written to a StreamBuffer when one is given, otherwise to a buffer of
+// their own that is orphaned every frame.
+//
+
+#pragma once
+
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+class StreamBuffer;
+
+// Vertex attribute locations used by the instanced vertex shader
+const GLuint INSTANCE_MATRIX_LOCATION = 2; // mat4 takes locations 2, 3, 4 and 5
+const GLuint INSTANCE_COLOR_LOCATION = 6;
+
+struct InstanceData
+{
+    glm::mat4 worldMatrix;
+    glm::vec3 color;
+};
+
+class InstancedRenderer
+{
+public:
+    InstancedRenderer();
+    ~InstancedRenderer();
+
+    // True when the context exposes instanced arrays (GL 3.3 or GL_ARB_instanced_arrays)
+    static bool isSupported();
+
+    // Attaches the per-instance attributes to the given vertex array object,
+    // which must have its element buffer. stream may be NULL.
+    void initialize(GLuint vertexArrayObject, StreamBuffer* stream = NULL);
+
+    // Room for that many instances per frame, so that add() does not allocate
+    void reserve(size_t instances);
+
+    void begin();
+    void add(const glm::mat4& worldMatrix, const glm::vec3& color);
+
+    // Uploads the instances collected since begin() and draws them in one call
+    void draw(GLenum mode, GLsizei indexCount, GLenum indexType);
+
+    size_t instanceCount() const { return mInstances.size(); }
+
+private:
+    // Points the instance attributes of the vertex array at buffer + offset
+    void setInstanceAttributes(GLuint buffer, size_t offset);
+
+    GLuint mVertexArrayObject;
+    StreamBuffer* mStream;
+    GLuint mInstanceBufferObject;   // used without a stream, or when its frame region is full
+    size_t mCapacity;
+    GLuint mAttributeBuffer;        // where the instance attributes currently point
+    size_t mAttributeOffset;
+    std::vector<InstanceData> mInstances;
+};
@@ -0,0 +1,171 @@
+//
+// COMP 371 Labs Framework
+//
+// Scaling benchmark of the job system, run with --bench-jobs: the per-frame
+// stages of a 1M-part scene (local matrices, world matrices, bounding boxes,
+// frustum culling) fanned out to 1, 2, 4, 8 and 16 workers.
+//
+
+#include "JobBenchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "TransformStore.h"
+
+namespace
+{
+    const size_t MODEL_COUNT = 125000;
+    const size_t PARTS_PER_MODEL = 8;
+    const size_t MODEL_STRIDE = PARTS_PER_MODEL + 1;    // a model followed by its parts
+    const size_t BATCH = 16;    // floats per cache line: chunks never share one
+    const int FRAMES = 20;
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // A world root, then every model followed by its parts, spread around the camera
+    void buildScene(TransformStore& store)
+    {
+        std::mt19937 random(371);
+        std::uniform_real_distribution<float> modelPosition(-60.0f, 60.0f);
+        std::uniform_real_distribution<float> partPosition(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+        std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+        store.reserve(1 + MODEL_COUNT * MODEL_STRIDE);
+        store.add(-1, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+        for (size_t i = 0; i < MODEL_COUNT; ++i)
+        {
+            unsigned int model = store.add(0, glm::vec3(modelPosition(random), modelPosition(random), modelPosition(random)),
+                glm::vec3(angle(random), angle(random), 0.0f), glm::vec3(1.0f), ROTATE_YXZ);
+            for (size_t j = 0; j < PARTS_PER_MODEL; ++j)
+            {
+                store.add((int)model, glm::vec3(partPosition(random), partPosition(random), partPosition(random)),
+                    glm::vec3(angle(random), angle(random), angle(random)), glm::vec3(scale(random), scale(random), scale(random)));
+            }
+        }
+    }
+
+    // One frame of the update side, every stage a parallel-for with the adaptive grain
+    size_t updateFrame(JobSystem& jobs, TransformStore& store, BoundingBoxSet& bounds, std::vector<unsigned char>& visible, const Frustum& frustum)
+    {
+        size_t count = store.size();
+        size_t batches = (count + BATCH - 1) / BATCH;
+
+        jobs.parallelFor(0, batches, 0, [&](size_t begin, size_t end)
+        {
+            store.composeLocalRange(BATCH * begin, std::min(BATCH * end, count));
+        });
+
+        // parents first: the root, then whole models with their parts
+        store.updateWorldRange(0, 1);
+        jobs.parallelFor(0, MODEL_COUNT, 0, [&](size_t begin, size_t end)
+        {
+            store.updateWorldRange(1 + MODEL_STRIDE * begin, 1 + MODEL_STRIDE * end);
+        });
+
+        // unit cubes, as in the scenes
+        jobs.parallelFor(0, batches, 0, [&](size_t begin, size_t end)
+        {
+            for (size_t i = BATCH * begin; i < std::min(BATCH * end, count); ++i)
+            {
+                glm::vec3 center, extent;
+                transformBoundingBox(store.worldMatrix((unsigned int)i), glm::vec3(0.0f), glm::vec3(0.5f), center, extent);
+                bounds.set(i, center, extent);
+            }
+        });
+
+        std::atomic<size_t> visibleCount(0);
+        jobs.parallelFor(0, batches, 0, [&](size_t begin, size_t end)
+        {
+            size_t first = BATCH * begin;
+            visibleCount += bounds.cull(frustum, first, std::min(BATCH * end, count), &visible[first]);
+        });
+        return visibleCount.load();
+    }
+}
+
+int runJobBenchmark(std::ostream& out)
+{
+    const unsigned int workerCounts[] = { 1, 2, 4, 8, 16 };
+
+    TransformStore store;
+    buildScene(store);
+    size_t count = store.size();
+    BoundingBoxSet bounds;
+    bounds.resize(count);
+    std::vector<unsigned char> visible(count);
+
+    glm::mat4 projection = glm::perspective(glm::radians(70.0f), 1024.0f / 768.0f, 0.01f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    out << MODEL_COUNT * PARTS_PER_MODEL << " parts in " << MODEL_COUNT << " models, "
+        << std::thread::hardware_concurrency() << " hardware threads, median of " << FRAMES << " frames" << std::endl;
+    out << "workers | frame ms | speedup | efficiency | visible | max error" << std::endl;
+
+    // the single worker run is the reference of the others
+    std::vector<glm::mat4> reference;
+    size_t referenceVisible = 0;
+    double singleMs = 0.0;
+
+    for (size_t w = 0; w < sizeof(workerCounts) / sizeof(workerCounts[0]); ++w)
+    {
+        JobSystem jobs(workerCounts[w]);
+
+        std::vector<double> frameMs(FRAMES);
+        size_t visibleCount = 0;
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            visibleCount = updateFrame(jobs, store, bounds, visible, frustum);
+            frameMs[frame] = elapsedMs(start);
+        }
+        std::sort(frameMs.begin(), frameMs.end());
+        double medianMs = frameMs[FRAMES / 2];
+
+        float maxError = 0.0f;
+        if (w == 0)
+        {
+            reference.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                reference[i] = store.worldMatrix((unsigned int)i);
+            referenceVisible = visibleCount;
+            singleMs = medianMs;
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    for (int row = 0; row < 4; ++row)
+                        maxError = std::max(maxError, std::fabs(reference[i][column][row] - store.worldMatrix((unsigned int)i)[column][row]));
+                }
+            }
+        }
+
+        double speedup = singleMs / medianMs;
+        out << workerCounts[w] << " | " << medianMs << " | " << speedup << "x | "
+            << 100.0 * speedup / workerCounts[w] << "% | " << visibleCount << " | " << maxError << std::endl;
+        if (visibleCount != referenceVisible)
+        {
+            out << "ERROR::JOB_BENCHMARK::VISIBLE_COUNT_MISMATCH" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
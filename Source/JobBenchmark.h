@@ -0,0 +1,14 @@
+//
+// COMP 371 Labs Framework
+//
+// Scaling benchmark of the job system, run with --bench-jobs: the per-frame
+// stages of a 1M-part scene (local matrices, world matrices, bounding boxes,
+// frustum culling) fanned out to 1, 2, 4, 8 and 16 workers.
+//
+
+#pragma once
+
+#include <ostream>
+
+// Prints one line per worker count, with the speedup over a single worker
+int runJobBenchmark(std::ostream& out);
@@ -0,0 +1,281 @@
+//
+// COMP 371 Labs Framework
+//
+// Work-stealing job system. Every worker has a Chase-Lev deque: it pushes and
+// pops jobs at the bottom of its own, idle workers steal from the top of the
+// others. A JobCounter counts the unfinished jobs of a group; wait() runs
+// queued jobs until the counter drops to zero.
+//
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <new>
+
+#include "AlignedAllocator.h"
+
+namespace
+{
+    // Worker index of the calling thread in the system it belongs to
+    thread_local const JobSystem* currentSystem = NULL;
+    thread_local int currentWorker = -1;
+
+    const int SPINS_BEFORE_SLEEP = 64;
+}
+
+JobSystem::JobDeque::JobDeque()
+    : mTop(0), mBottom(0)
+{
+    for (size_t i = 0; i < QUEUE_SIZE; ++i)
+        mJobs[i].store(NULL, std::memory_order_relaxed);
+}
+
+bool JobSystem::JobDeque::push(Job* job)
+{
+    long bottom = mBottom.load(std::memory_order_relaxed);
+    long top = mTop.load(std::memory_order_acquire);
+    if (bottom - top >= (long)QUEUE_SIZE)
+        return false;
+    mJobs[bottom & (QUEUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+    // publishes the job's fields with it
+    mBottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+JobSystem::Job* JobSystem::JobDeque::pop()
+{
+    // the bottom is claimed before the top is read, a thief racing for the
+    // last job sees it and the CAS on the top decides who gets it
+    long bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(bottom, std::memory_order_seq_cst);
+    long top = mTop.load(std::memory_order_seq_cst);
+    if (top > bottom)
+    {
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = mJobs[bottom & (QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = NULL;
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::Job* JobSystem::JobDeque::steal()
+{
+    long top = mTop.load(std::memory_order_seq_cst);
+    long bottom = mBottom.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+        return NULL;
+
+    Job* job = mJobs[top & (QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return NULL;    // taken by the owner or another thief
+    return job;
+}
+
+bool JobSystem::JobDeque::isEmpty() const
+{
+    return mBottom.load(std::memory_order_relaxed) <= mTop.load(std::memory_order_relaxed);
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+    : mQueuedJobs(0), mSleepingWorkers(0), mQuit(false)
+{
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    mWorkers.resize(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        // the deque indices are cache line aligned, plain new does not align before C++17
+        void* memory = alignedMalloc(sizeof(Worker), alignof(Worker));
+        if (memory == NULL)
+            throw std::bad_alloc();
+        Worker* worker = new (memory) Worker();
+        worker->nextJob = 0;
+        worker->random = 2463534242u + 7919u * i;
+        for (size_t j = 0; j < QUEUE_SIZE; ++j)
+            worker->pool[j].busy.store(false, std::memory_order_relaxed);
+        mWorkers[i] = worker;
+    }
+
+    currentSystem = this;
+    currentWorker = 0;
+    mThreads.reserve(workerCount - 1);
+    for (unsigned int i = 1; i < workerCount; ++i)
+        mThreads.push_back(std::thread(&JobSystem::workerMain, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mQuit.store(true);
+    }
+    mWakeUp.notify_all();
+    for (size_t i = 0; i < mThreads.size(); ++i)
+        mThreads[i].join();
+
+    for (size_t i = 0; i < mWorkers.size(); ++i)
+    {
+        mWorkers[i]->~Worker();
+        alignedFree(mWorkers[i]);
+    }
+    if (currentSystem == this)
+    {
+        currentSystem = NULL;
+        currentWorker = -1;
+    }
+}
+
+int JobSystem::workerIndex() const
+{
+    return (currentSystem == this) ? currentWorker : -1;
+}
+
+bool JobSystem::isQueueEmpty() const
+{
+    int index = workerIndex();
+    return index < 0 || mWorkers[index]->queue.isEmpty();
+}
+
+void JobSystem::run(JobFunction function, void* data, size_t begin, size_t end, JobCounter* counter)
+{
+    if (counter != NULL)
+        counter->mValue.fetch_add(1, std::memory_order_relaxed);
+
+    int index = workerIndex();
+    Job* job = NULL;
+    if (index >= 0)
+    {
+        Worker& worker = *mWorkers[index];
+        Job* slot = &worker.pool[worker.nextJob++ & (QUEUE_SIZE - 1)];
+        if (!slot->busy.load(std::memory_order_acquire))
+            job = slot;
+    }
+
+    // no free slot, or not called from a worker: the caller does the work
+    if (job == NULL)
+    {
+        function(data, begin, end);
+        if (counter != NULL)
+            counter->mValue.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    job->function = function;
+    job->data = data;
+    job->begin = begin;
+    job->end = end;
+    job->counter = counter;
+    job->busy.store(true, std::memory_order_relaxed);
+    if (!mWorkers[index]->queue.push(job))
+    {
+        execute(*job);
+        return;
+    }
+
+    mQueuedJobs.fetch_add(1);
+    if (mSleepingWorkers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mWakeUp.notify_one();
+    }
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+    int index = workerIndex();
+    while (!counter.isDone())
+    {
+        if (index < 0 || !runOneJob((unsigned int)index))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::execute(Job& job)
+{
+    JobCounter* counter = job.counter;
+    job.function(job.data, job.begin, job.end);
+    job.busy.store(false, std::memory_order_release);
+    if (counter != NULL)
+        counter->mValue.fetch_sub(1, std::memory_order_release);
+}
+
+bool JobSystem::runOneJob(unsigned int index)
+{
+    Job* job = mWorkers[index]->queue.pop();
+    if (job == NULL)
+        job = stealJob(index);
+    if (job == NULL)
+        return false;
+
+    mQueuedJobs.fetch_sub(1);
+    execute(*job);
+    return true;
+}
+
+JobSystem::Job* JobSystem::stealJob(unsigned int index)
+{
+    unsigned int count = (unsigned int)mWorkers.size();
+    if (count < 2)
+        return NULL;
+
+    // xorshift32, a different first victim every time spreads the thieves
+    unsigned int& random = mWorkers[index]->random;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    unsigned int first = random % count;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int victim = (first + i) % count;
+        if (victim == index)
+            continue;
+        Job* job = mWorkers[victim]->queue.steal();
+        if (job != NULL)
+            return job;
+    }
+    return NULL;
+}
+
+void JobSystem::workerMain(unsigned int index)
+{
+    currentSystem = this;
+    currentWorker = (int)index;
+
+    int idleRounds = 0;
+    while (!mQuit.load(std::memory_order_relaxed))
+    {
+        if (runOneJob(index))
+        {
+            idleRounds = 0;
+        }
+        else if (++idleRounds < SPINS_BEFORE_SLEEP)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            sleep();
+            idleRounds = 0;
+        }
+    }
+}
+
+void JobSystem::sleep()
+{
+    // run() counts a job as queued before it looks for sleepers, and a
+    // worker counts itself as sleeping before it looks for jobs, so one of
+    // the two always sees the other
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+    mSleepingWorkers.fetch_add(1);
+    while (mQueuedJobs.load() <= 0 && !mQuit.load())
+        mWakeUp.wait(lock);
+    mSleepingWorkers.fetch_sub(1);
+}
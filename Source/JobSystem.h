@@ -0,0 +1,187 @@
+//
+// COMP 371 Labs Framework
+//
+// Work-stealing job system. Every worker has a Chase-Lev deque: it pushes and
+// pops jobs at the bottom of its own, idle workers steal from the top of the
+// others. A JobCounter counts the unfinished jobs of a group; wait() runs
+// queued jobs until the counter drops to zero, so a job that depends on
+// others simply waits on their counter. parallelFor() splits a range lazily:
+// it runs grain-sized chunks and hands half of what is left to thieves
+// whenever its own deque is empty, so the chunks adapt to how busy the
+// workers are.
+//
+// Jobs are submitted from the thread that created the system or from jobs.
+// There are no allocations per job; when a worker's pool or deque is full,
+// the job runs right away on the submitting thread instead.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Number of unfinished jobs of a group
+class JobCounter
+{
+public:
+    JobCounter() : mValue(0) {}
+
+    bool isDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+
+private:
+    JobCounter(const JobCounter&);
+    JobCounter& operator=(const JobCounter&);
+
+    friend class JobSystem;
+    std::atomic<int> mValue;
+};
+
+// function(data, begin, end), the range is the job's share of the work
+typedef void (*JobFunction)(void* data, size_t begin, size_t end);
+
+class JobSystem
+{
+public:
+    // workerCount counts the creating thread, which works while it waits;
+    // 0 uses one worker per hardware thread
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    unsigned int workerCount() const { return (unsigned int)mWorkers.size(); }
+
+    // Queues function(data, begin, end). counter, if any, is incremented now
+    // and decremented once the function returned.
+    void run(JobFunction function, void* data, size_t begin, size_t end, JobCounter* counter);
+
+    // Runs queued jobs, stolen ones included, until counter is done
+    void wait(const JobCounter& counter);
+
+    // body(chunkBegin, chunkEnd) over [begin, end), returns when all chunks
+    // are done. Chunks are at least grain long except the last one; 0 picks
+    // a grain from the range size and the worker count.
+    template <typename Body>
+    void parallelFor(size_t begin, size_t end, size_t grain, const Body& body);
+
+private:
+    JobSystem(const JobSystem&);
+    JobSystem& operator=(const JobSystem&);
+
+    static const size_t QUEUE_SIZE = 1024;  // jobs queued per worker, a power of two
+
+    struct Job
+    {
+        JobFunction function;
+        void* data;
+        size_t begin;
+        size_t end;
+        JobCounter* counter;
+        std::atomic<bool> busy;     // between run() and the end of the function
+    };
+
+    // Chase-Lev deque of fixed size (Le et al., "Correct and Efficient
+    // Work-Stealing for Weak Memory Models"): push and pop by the owner,
+    // steal by anyone
+    class JobDeque
+    {
+    public:
+        JobDeque();
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+        bool isEmpty() const;
+
+    private:
+        std::atomic<Job*> mJobs[QUEUE_SIZE];
+        alignas(64) std::atomic<long> mTop;
+        alignas(64) std::atomic<long> mBottom;
+    };
+
+    struct Worker
+    {
+        JobDeque queue;
+        Job pool[QUEUE_SIZE];   // reused round-robin, a busy slot is never handed out
+        unsigned int nextJob;
+        unsigned int random;    // xorshift state picking the victims
+    };
+
+    template <typename Body>
+    struct ParallelFor
+    {
+        JobSystem* jobs;
+        const Body* body;
+        size_t grain;
+        JobCounter counter;
+    };
+
+    template <typename Body>
+    static void runRange(void* data, size_t begin, size_t end);
+
+    int workerIndex() const;        // of the calling thread, -1 outside the system
+    bool isQueueEmpty() const;      // the calling worker's
+    bool runOneJob(unsigned int index);
+    Job* stealJob(unsigned int index);
+    void execute(Job& job);
+    void workerMain(unsigned int index);
+    void sleep();
+
+    std::vector<Worker*> mWorkers;  // 0 is the creating thread
+    std::vector<std::thread> mThreads;
+
+    // idle workers sleep until a job is queued
+    std::atomic<int> mQueuedJobs;
+    std::atomic<int> mSleepingWorkers;
+    std::atomic<bool> mQuit;
+    std::mutex mSleepMutex;
+    std::condition_variable mWakeUp;
+};
+
+template <typename Body>
+void JobSystem::runRange(void* data, size_t begin, size_t end)
+{
+    ParallelFor<Body>& loop = *static_cast<ParallelFor<Body>*>(data);
+    while (begin < end)
+    {
+        // nothing queued here, the other workers may be idle: offer them half of the rest
+        if (end - begin > 2 * loop.grain && loop.jobs->isQueueEmpty())
+        {
+            size_t middle = begin + (end - begin) / 2;
+            loop.jobs->run(&runRange<Body>, data, middle, end, &loop.counter);
+            end = middle;
+            continue;
+        }
+        size_t chunkEnd = (end - begin > loop.grain) ? begin + loop.grain : end;
+        (*loop.body)(begin, chunkEnd);
+        begin = chunkEnd;
+    }
+}
+
+template <typename Body>
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, const Body& body)
+{
+    if (begin >= end)
+        return;
+    size_t count = end - begin;
+    if (grain == 0)
+        grain = count / (16 * mWorkers.size());
+    grain = (grain > 0) ? grain : 1;
+    if (mWorkers.size() == 1 || count <= grain || workerIndex() < 0)
+    {
+        body(begin, end);
+        return;
+    }
+
+    ParallelFor<Body> loop;
+    loop.jobs = this;
+    loop.body = &body;
+    loop.grain = grain;
+    loop.counter.mValue.store(1, std::memory_order_relaxed);
+    runRange<Body>(&loop, begin, end);
+    loop.counter.mValue.fetch_sub(1, std::memory_order_release);
+    wait(loop.counter);
+}
@@ -0,0 +1,112 @@
+//
+// COMP 371 Labs Framework
+//
+// Bounded multi-producer multi-consumer queue without locks. Every slot has
+// a sequence number telling whether it is free for the producer of a given
+// turn or holds a value for the consumer of that turn, so producers and
+// consumers only contend on their own index. Capacity is a power of two;
+// tryPush() fails instead of blocking when the ring is full.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class LockFreeRing
+{
+public:
+    explicit LockFreeRing(size_t capacity)
+        : mSlots(roundUpToPowerOfTwo(capacity)), mMask(mSlots.size() - 1), mHead(0), mTail(0)
+    {
+        for (size_t i = 0; i < mSlots.size(); ++i)
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(const T& value)
+    {
+        size_t position = mTail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = mSlots[position & mMask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+            if (difference == 0)
+            {
+                if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;   // full
+            }
+            else
+            {
+                position = mTail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value)
+    {
+        size_t position = mHead.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = mSlots[position & mMask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+            if (difference == 0)
+            {
+                if (mHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = slot.value;
+                    slot.sequence.store(position + mMask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;   // empty
+            }
+            else
+            {
+                position = mHead.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return mSlots.size(); }
+
+private:
+    LockFreeRing(const LockFreeRing&);
+    LockFreeRing& operator=(const LockFreeRing&);
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+
+        Slot() : sequence(0), value() {}
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t power = 2;
+        while (power < value)
+            power *= 2;
+        return power;
+    }
+
+    std::vector<Slot> mSlots;
+    const size_t mMask;
+
+    // producers and consumers on separate cache lines
+    alignas(64) std::atomic<size_t> mHead;
+    alignas(64) std::atomic<size_t> mTail;
+};
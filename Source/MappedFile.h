@@ -0,0 +1,35 @@
+//
+// COMP 371 Labs Framework
+//
+// Read-only memory mapping of a whole file.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& path);
+    void close();
+
+    const void* data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool isOpen() const { return mData != NULL; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const void* mData;
+    size_t mSize;
+#if defined(_WIN32)
+    void* mFileHandle;
+    void* mMappingHandle;
+#endif
+};
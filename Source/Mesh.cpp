@@ -0,0 +1,168 @@
+//
+// COMP 371 Labs Framework
+//
+// Indexed triangle mesh in a vertex array with its own vertex and element
+// buffers. Triangle lists are welded into unique vertices, reordered for the
+// post-transform vertex cache and the vertices laid out in first-use order
+// before they are encoded in the requested vertex format and uploaded.
+//
+
+#include "Mesh.h"
+
+#include <cstring>
+#include <map>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "VertexCacheOptimizer.h"
+
+namespace
+{
+    // Bitwise ordering, vertices are only merged when they are exactly equal
+    struct VertexLess
+    {
+        bool operator()(const MeshVertex& a, const MeshVertex& b) const
+        {
+            return memcmp(&a, &b, sizeof(MeshVertex)) < 0;
+        }
+    };
+}
+
+Mesh::Mesh()
+    : mVertexArrayObject(0), mVertexBufferObject(0), mElementBufferObject(0), mIndexCount(0), mIndexType(GL_UNSIGNED_SHORT), mDequantization(1.0f)
+{
+}
+
+Mesh::~Mesh()
+{
+    destroy();
+}
+
+void Mesh::destroy()
+{
+    if (mElementBufferObject != 0)
+    {
+        GLStateCache::forgetBuffer(mElementBufferObject);
+        glDeleteBuffers(1, &mElementBufferObject);
+    }
+    if (mVertexBufferObject != 0)
+    {
+        GLStateCache::forgetBuffer(mVertexBufferObject);
+        glDeleteBuffers(1, &mVertexBufferObject);
+    }
+    if (mVertexArrayObject != 0)
+    {
+        GLStateCache::forgetVertexArray(mVertexArrayObject);
+        glDeleteVertexArrays(1, &mVertexArrayObject);
+    }
+    mElementBufferObject = 0;
+    mVertexBufferObject = 0;
+    mVertexArrayObject = 0;
+    mIndexCount = 0;
+    mDequantization = glm::mat4(1.0f);
+}
+
+bool Mesh::createFromTriangles(const VertexFormat& format, const MeshVertex* vertices, size_t vertexCount, MeshOptimizationStats* stats)
+{
+    // same as create() with no vertices
+    if (vertexCount == 0)
+    {
+        destroy();
+        return false;
+    }
+
+    // weld: one index per input vertex into the unique vertices
+    std::vector<MeshVertex> uniqueVertices;
+    std::vector<unsigned int> indices(vertexCount);
+    std::map<MeshVertex, unsigned int, VertexLess> lookup;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        std::pair<std::map<MeshVertex, unsigned int, VertexLess>::iterator, bool> inserted =
+            lookup.insert(std::make_pair(vertices[i], (unsigned int)uniqueVertices.size()));
+        if (inserted.second)
+            uniqueVertices.push_back(vertices[i]);
+        indices[i] = inserted.first->second;
+    }
+    float weldedAcmr = computeAcmr(&indices[0], indices.size());
+
+    optimizeVertexCache(&indices[0], indices.size(), uniqueVertices.size());
+
+    // vertices in the order the triangles first use them, so fetches stay sequential
+    std::vector<unsigned int> remap(uniqueVertices.size(), ~0u);
+    std::vector<MeshVertex> orderedVertices;
+    orderedVertices.reserve(uniqueVertices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        unsigned int& newIndex = remap[indices[i]];
+        if (newIndex == ~0u)
+        {
+            newIndex = (unsigned int)orderedVertices.size();
+            orderedVertices.push_back(uniqueVertices[indices[i]]);
+        }
+        indices[i] = newIndex;
+    }
+
+    if (stats != NULL)
+    {
+        stats->inputVertices = vertexCount;
+        stats->vertices = orderedVertices.size();
+        stats->indices = indices.size();
+        stats->weldedAcmr = weldedAcmr;
+        stats->optimizedAcmr = computeAcmr(&indices[0], indices.size());
+        stats->fullVertexBytes = orderedVertices.size() * VertexFormat::full(format.normal != NORMAL_NONE).stride();
+        stats->vertexBytes = orderedVertices.size() * format.stride();
+    }
+
+    return create(format, orderedVertices, indices);
+}
+
+bool Mesh::create(const VertexFormat& format, const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices)
+{
+    destroy();
+    if (vertices.empty() || indices.empty())
+        return false;
+
+    std::vector<unsigned char> encodedVertices;
+    encodeVertices(format, &vertices[0], vertices.size(), encodedVertices, mDequantization);
+
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+
+    glGenBuffers(1, &mVertexBufferObject);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, encodedVertices.size(), &encodedVertices[0], GL_STATIC_DRAW);
+    setVertexAttributes(format);
+
+    // the element buffer binding is recorded in the vertex array
+    glGenBuffers(1, &mElementBufferObject);
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBufferObject);
+    if (vertices.size() <= 0xffff)
+    {
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), &shortIndices[0], GL_STATIC_DRAW);
+        mIndexType = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+        mIndexType = GL_UNSIGNED_INT;
+    }
+    mIndexCount = (GLsizei)indices.size();
+
+    // unbind the vertex array first, unbinding the element buffer would detach it
+    GLStateCache::bindVertexArray(0);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void Mesh::draw(GLenum mode) const
+{
+    if (mIndexCount == 0)
+        return;
+
+    GLStateCache::bindVertexArray(mVertexArrayObject);
+    glDrawElements(mode, mIndexCount, mIndexType, 0);
+    frameStats.drawCalls++;
+    if (mode == GL_TRIANGLES)
+        frameStats.trianglesSubmitted += mIndexCount / 3;
+}
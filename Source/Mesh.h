@@ -0,0 +1,68 @@
+//
+// COMP 371 Labs Framework
+//
+// Indexed triangle mesh in a vertex array with its own vertex and element
+// buffers. Triangle lists are welded into unique vertices, reordered for the
+// post-transform vertex cache and the vertices laid out in first-use order
+// before they are encoded in the requested vertex format and uploaded.
+//
+
+#pragma once
+
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "VertexFormat.h"
+
+// What createFromTriangles did to a mesh
+struct MeshOptimizationStats
+{
+    size_t inputVertices;   // vertices of the unindexed triangle list
+    size_t vertices;        // unique vertices after welding
+    size_t indices;
+    float weldedAcmr;       // cache misses per triangle before the reordering
+    float optimizedAcmr;    // and after, 3.0 for the unindexed list
+    size_t fullVertexBytes; // vertex buffer size with every attribute as floats
+    size_t vertexBytes;     // and in the format it was uploaded with
+};
+
+class Mesh
+{
+public:
+    Mesh();
+    ~Mesh();
+
+    // Welds, optimizes and uploads a triangle list of vertexCount vertices
+    bool createFromTriangles(const VertexFormat& format, const MeshVertex* vertices, size_t vertexCount, MeshOptimizationStats* stats = NULL);
+
+    // Encodes and uploads vertices and indices as they are. Indices are stored
+    // as 16 bits when there are few enough vertices. Replaces any previous mesh.
+    bool create(const VertexFormat& format, const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices);
+    void destroy();
+
+    // glDrawElements of the whole mesh, uses the current program. The world
+    // matrix has to include dequantization().
+    void draw(GLenum mode) const;
+
+    // Maps the stored positions to model space, identity for float positions
+    const glm::mat4& dequantization() const { return mDequantization; }
+
+    GLuint vertexArray() const { return mVertexArrayObject; }
+    GLsizei indexCount() const { return mIndexCount; }
+    GLenum indexType() const { return mIndexType; }
+
+private:
+    Mesh(const Mesh&);
+    Mesh& operator=(const Mesh&);
+
+    GLuint mVertexArrayObject;
+    GLuint mVertexBufferObject;
+    GLuint mElementBufferObject;
+    GLsizei mIndexCount;
+    GLenum mIndexType;      // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    glm::mat4 mDequantization;
+};
@@ -0,0 +1,196 @@
+//
+// COMP 371 Labs Framework
+//
+// OpenGL 3.3 core context without a window, used by --headless to render on
+// machines that have no display. Created through EGL on a Mesa surfaceless
+// display when available, so llvmpipe works without X11. The context only
+// has a 1x1 pbuffer, frames are drawn into a Framebuffer instead.
+// Only implemented on Linux, create() fails elsewhere.
+//
+
+#include "OffscreenContext.h"
+
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+OffscreenContext::OffscreenContext()
+    : mDisplay(NULL), mSurface(NULL), mContext(NULL)
+{
+}
+
+OffscreenContext::~OffscreenContext()
+{
+    destroy();
+}
+
+#if defined(__linux__)
+
+namespace
+{
+    bool hasExtension(const char* extensions, const char* name)
+    {
+        if (extensions == NULL)
+            return false;
+
+        size_t length = strlen(name);
+        for (const char* match = strstr(extensions, name); match != NULL; match = strstr(match + length, name))
+        {
+            bool starts = (match == extensions || match[-1] == ' ');
+            bool ends = (match[length] == ' ' || match[length] == '\0');
+            if (starts && ends)
+                return true;
+        }
+        return false;
+    }
+
+    // A display that needs no window system, or the default one when the
+    // driver does not have the surfaceless platform
+    EGLDisplay openDisplay()
+    {
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless") && hasExtension(clientExtensions, "EGL_EXT_platform_base"))
+        {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay != NULL)
+            {
+                EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+                if (display != EGL_NO_DISPLAY)
+                    return display;
+            }
+        }
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+}
+
+bool OffscreenContext::create()
+{
+    destroy();
+
+    EGLDisplay display = openDisplay();
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cerr << "ERROR::OFFSCREEN::NO_DISPLAY" << std::endl;
+        return false;
+    }
+    mDisplay = display;
+
+    // EGL_CONTEXT_MAJOR_VERSION and the core profile attributes need EGL 1.5
+    // or EGL_KHR_create_context
+    if ((major == 1 && minor < 5) && !hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_create_context"))
+    {
+        std::cerr << "ERROR::OFFSCREEN::NO_CORE_PROFILE EGL " << major << "." << minor << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0 || !eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "ERROR::OFFSCREEN::NO_CONFIG" << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE)
+    {
+        std::cerr << "ERROR::OFFSCREEN::PBUFFER_CREATION_FAILED" << std::endl;
+        destroy();
+        return false;
+    }
+    mSurface = surface;
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cerr << "ERROR::OFFSCREEN::CONTEXT_CREATION_FAILED" << std::endl;
+        destroy();
+        return false;
+    }
+    mContext = context;
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        std::cerr << "ERROR::OFFSCREEN::MAKE_CURRENT_FAILED" << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::destroy()
+{
+    if (mDisplay == NULL)
+        return;
+
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (mContext != NULL)
+        eglDestroyContext(mDisplay, mContext);
+    if (mSurface != NULL)
+        eglDestroySurface(mDisplay, mSurface);
+    eglTerminate(mDisplay);
+
+    mDisplay = NULL;
+    mSurface = NULL;
+    mContext = NULL;
+}
+
+bool OffscreenContext::makeCurrent()
+{
+    // the client API is per thread, OpenGL ES is the default of a new one
+    if (mDisplay == NULL || !eglBindAPI(EGL_OPENGL_API) || !eglMakeCurrent(mDisplay, mSurface, mSurface, mContext))
+    {
+        std::cerr << "ERROR::OFFSCREEN::MAKE_CURRENT_FAILED" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::release()
+{
+    if (mDisplay != NULL)
+        eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+#else
+
+bool OffscreenContext::create()
+{
+    std::cerr << "Headless rendering is only available in Linux builds, which the framework has no project for yet" << std::endl;
+    return false;
+}
+
+void OffscreenContext::destroy()
+{
+}
+
+bool OffscreenContext::makeCurrent()
+{
+    return false;
+}
+
+void OffscreenContext::release()
+{
+}
+
+#endif
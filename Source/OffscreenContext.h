@@ -0,0 +1,39 @@
+//
+// COMP 371 Labs Framework
+//
+// OpenGL 3.3 core context without a window, used by --headless to render on
+// machines that have no display. Created through EGL on a Mesa surfaceless
+// display when available, so llvmpipe works without X11. The context only
+// has a 1x1 pbuffer, frames are drawn into a Framebuffer instead.
+// Only implemented on Linux, create() fails elsewhere. The framework has no
+// Linux project yet: the sources have to be built against EGL and libOpenGL
+// by hand to use it.
+//
+
+#pragma once
+
+class OffscreenContext
+{
+public:
+    OffscreenContext();
+    ~OffscreenContext();
+
+    // Creates the context and makes it current on the calling thread
+    bool create();
+    void destroy();
+
+    // Moves the context to the calling thread, it must not be current on another one
+    bool makeCurrent();
+    // Detaches the context from the calling thread
+    void release();
+
+private:
+    OffscreenContext(const OffscreenContext&);
+    OffscreenContext& operator=(const OffscreenContext&);
+
+    // EGLDisplay, EGLSurface and EGLContext, kept opaque so that this header
+    // does not pull the EGL headers into the rest of the framework
+    void* mDisplay;
+    void* mSurface;
+    void* mContext;
+};
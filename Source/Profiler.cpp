@@ -0,0 +1,220 @@
+//
+// COMP 371 Labs Framework
+//
+// Frame profiler. PROFILE_ZONE times the enclosing scope on the CPU and
+// PROFILE_GPU_ZONE also brackets it with GL_TIMESTAMP queries, which are read
+// a few frames later so the CPU never waits for the GPU. Finished zones go
+// through a lock-free ring, so any thread can record them, and are written as
+// Chrome trace events (chrome://tracing or ui.perfetto.dev).
+//
+
+#include "Profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+
+    // 0 for the first thread that records a zone, usually the main thread
+    uint32_t currentThread()
+    {
+        static std::atomic<uint32_t> nextThread(0);
+        static thread_local uint32_t thread = nextThread++;
+        return thread;
+    }
+
+    void writeJsonString(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (; *text != '\0'; ++text)
+        {
+            if (*text == '"' || *text == '\\')
+                out << '\\';
+            if ((unsigned char)*text >= 0x20)
+                out << *text;
+        }
+        out << '"';
+    }
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : mRing(1 << 14), mDroppedEvents(0), mGpuInitialized(false), mGpuFrame(0), mOldestGpuFrame(0), mGpuClockOffset(0)
+{
+    memset(mGpuFrames, 0, sizeof(mGpuFrames));
+    // taken once, recording events never allocates during the frame loop
+    mEvents.reserve(MAX_EVENTS);
+}
+
+uint64_t Profiler::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ProfileEvent event = { name, start, end - start, currentThread() };
+    if (!mRing.tryPush(event))
+        mDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::addEvent(const ProfileEvent& event)
+{
+    if (mEvents.size() < MAX_EVENTS)
+        mEvents.push_back(event);
+    else
+        ++mDroppedEvents;
+}
+
+void Profiler::drainRing()
+{
+    ProfileEvent event;
+    while (mRing.tryPop(event))
+        addEvent(event);
+}
+
+void Profiler::initializeGpu()
+{
+    if (mGpuInitialized)
+        return;
+
+    for (unsigned int i = 0; i < GPU_FRAMES; ++i)
+    {
+        glGenQueries(2 * GPU_ZONES_PER_FRAME, mGpuFrames[i].queries);
+        mGpuFrames[i].zoneCount = 0;
+    }
+
+    // one round trip to the driver, only done here
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    mGpuClockOffset = (int64_t)now() - (int64_t)gpuTime;
+
+    mGpuFrame = 0;
+    mOldestGpuFrame = 0;
+    mGpuInitialized = true;
+}
+
+void Profiler::shutdownGpu()
+{
+    if (!mGpuInitialized)
+        return;
+
+    for (; mOldestGpuFrame <= mGpuFrame; ++mOldestGpuFrame)
+        collectGpuFrame(mGpuFrames[mOldestGpuFrame % GPU_FRAMES], true);
+
+    for (unsigned int i = 0; i < GPU_FRAMES; ++i)
+        glDeleteQueries(2 * GPU_ZONES_PER_FRAME, mGpuFrames[i].queries);
+    mGpuInitialized = false;
+}
+
+bool Profiler::collectGpuFrame(GpuFrame& frame, bool wait)
+{
+    if (frame.zoneCount == 0)
+        return true;
+
+    // timestamps complete in order, the last end of the frame is the last to arrive
+    GLuint available = GL_FALSE;
+    if (!wait)
+    {
+        glGetQueryObjectuiv(frame.queries[2 * frame.zoneCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    for (unsigned int i = 0; i < frame.zoneCount; ++i)
+    {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+        ProfileEvent event = { frame.names[i], (uint64_t)((int64_t)begin + mGpuClockOffset), end - begin, GPU_THREAD };
+        addEvent(event);
+    }
+    frame.zoneCount = 0;
+    return true;
+}
+
+void Profiler::newFrame()
+{
+    drainRing();
+    if (!mGpuInitialized)
+        return;
+
+    // results of earlier frames, oldest first, without waiting. A frame that
+    // is still not done when its queries are needed again is dropped.
+    ++mGpuFrame;
+    for (; mOldestGpuFrame < mGpuFrame; ++mOldestGpuFrame)
+    {
+        GpuFrame& frame = mGpuFrames[mOldestGpuFrame % GPU_FRAMES];
+        if (collectGpuFrame(frame, false))
+            continue;
+        if (mGpuFrame - mOldestGpuFrame < GPU_FRAMES)
+            break;
+        mDroppedEvents += frame.zoneCount;
+        frame.zoneCount = 0;
+    }
+}
+
+int Profiler::beginGpuZone(const char* name)
+{
+    GpuFrame& frame = mGpuFrames[mGpuFrame % GPU_FRAMES];
+    if (!mGpuInitialized || frame.zoneCount == GPU_ZONES_PER_FRAME)
+        return -1;
+
+    int zone = frame.zoneCount++;
+    frame.names[zone] = name;
+    glQueryCounter(frame.queries[2 * zone], GL_TIMESTAMP);
+    return zone;
+}
+
+void Profiler::endGpuZone(int zone)
+{
+    glQueryCounter(mGpuFrames[mGpuFrame % GPU_FRAMES].queries[2 * zone + 1], GL_TIMESTAMP);
+}
+
+bool Profiler::writeChromeTrace(const std::string& path)
+{
+    drainRing();
+
+    std::ofstream out(path.c_str());
+    if (!out)
+    {
+        std::cerr << "ERROR::PROFILER::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    // complete ("X") events in microseconds, GPU zones on their own track
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Main thread\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (size_t i = 0; i < mEvents.size(); ++i)
+    {
+        const ProfileEvent& event = mEvents[i];
+        out << ",\n{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"" << (event.thread == GPU_THREAD ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+    }
+    out << "\n]}\n";
+
+    if (mDroppedEvents > 0)
+        std::cerr << mDroppedEvents << " profile events were dropped, the ring or the trace was full" << std::endl;
+
+    mEvents.clear();
+    mDroppedEvents = 0;
+    return out.good();
+}
+
+#endif
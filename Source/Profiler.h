@@ -0,0 +1,147 @@
+//
+// COMP 371 Labs Framework
+//
+// Frame profiler. PROFILE_ZONE times the enclosing scope on the CPU and
+// PROFILE_GPU_ZONE also brackets it with GL_TIMESTAMP queries, which are read
+// a few frames later so the CPU never waits for the GPU. Finished zones go
+// through a lock-free ring, so any thread can record them, and are written as
+// Chrome trace events (chrome://tracing or ui.perfetto.dev).
+//
+// Everything compiles to nothing unless PROFILER_ENABLED is 1, the default of
+// debug builds. Define PROFILER_ENABLED=1 to profile a release build.
+//
+
+#pragma once
+
+#if !defined(PROFILER_ENABLED)
+#if defined(NDEBUG)
+#define PROFILER_ENABLED 0
+#else
+#define PROFILER_ENABLED 1
+#endif
+#endif
+
+#if PROFILER_ENABLED
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "LockFreeRing.h"
+
+struct ProfileEvent
+{
+    const char* name;   // not copied, must outlive the profiler (string literals, scene names)
+    uint64_t start;     // nanoseconds since the profiler was created
+    uint64_t duration;
+    uint32_t thread;    // Profiler::GPU_THREAD for GPU zones
+};
+
+class Profiler
+{
+public:
+    static const uint32_t GPU_THREAD = 0xffff;
+
+    static Profiler& instance();
+
+    // Creates the timestamp queries and lines the GPU clock up with the CPU
+    // one, on the thread of the current context. Without it GPU zones are ignored.
+    void initializeGpu();
+    // Collects the remaining GPU results, waiting for them, and deletes the queries
+    void shutdownGpu();
+
+    // Frame boundary, on the GL thread: collects the GPU zones of earlier
+    // frames that are ready and moves the recorded events out of the ring
+    void newFrame();
+
+    uint64_t now() const;
+
+    // Any thread, dropped when the ring is full
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    // GL thread only, -1 when the frame has no query left
+    int beginGpuZone(const char* name);
+    void endGpuZone(int zone);
+
+    // Writes the events collected since the last trace, then forgets them
+    bool writeChromeTrace(const std::string& path);
+
+private:
+    Profiler();
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+
+    static const unsigned int GPU_FRAMES = 4;     // frames in flight before GPU results are dropped
+    static const unsigned int GPU_ZONES_PER_FRAME = 64;
+    static const size_t MAX_EVENTS = 1 << 20;     // kept between two traces
+
+    struct GpuFrame
+    {
+        GLuint queries[2 * GPU_ZONES_PER_FRAME];  // begin and end timestamp of every zone
+        const char* names[GPU_ZONES_PER_FRAME];
+        unsigned int zoneCount;
+    };
+
+    void drainRing();
+    bool collectGpuFrame(GpuFrame& frame, bool wait);
+    void addEvent(const ProfileEvent& event);
+
+    LockFreeRing<ProfileEvent> mRing;
+    std::vector<ProfileEvent> mEvents;
+    std::atomic<size_t> mDroppedEvents;
+
+    bool mGpuInitialized;
+    GpuFrame mGpuFrames[GPU_FRAMES];
+    unsigned int mGpuFrame;         // frame being recorded, counts up
+    unsigned int mOldestGpuFrame;   // oldest frame whose results were not collected yet
+    int64_t mGpuClockOffset;        // CPU nanoseconds - GPU nanoseconds
+};
+
+// Times its lifetime, see PROFILE_ZONE
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name, bool gpu)
+        : mName(name), mGpuZone(gpu ? Profiler::instance().beginGpuZone(name) : -1), mStart(Profiler::instance().now())
+    {
+    }
+
+    ~ProfileZone()
+    {
+        Profiler& profiler = Profiler::instance();
+        profiler.record(mName, mStart, profiler.now());
+        if (mGpuZone >= 0)
+            profiler.endGpuZone(mGpuZone);
+    }
+
+private:
+    ProfileZone(const ProfileZone&);
+    ProfileZone& operator=(const ProfileZone&);
+
+    const char* mName;
+    int mGpuZone;
+    uint64_t mStart;
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name, false)
+#define PROFILE_GPU_ZONE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name, true)
+#define PROFILE_FRAME() Profiler::instance().newFrame()
+#define PROFILE_GPU_INITIALIZE() Profiler::instance().initializeGpu()
+#define PROFILE_GPU_SHUTDOWN() Profiler::instance().shutdownGpu()
+
+#else
+
+#define PROFILE_ZONE(name) do { } while (0)
+#define PROFILE_GPU_ZONE(name) do { } while (0)
+#define PROFILE_FRAME() do { } while (0)
+#define PROFILE_GPU_INITIALIZE() do { } while (0)
+#define PROFILE_GPU_SHUTDOWN() do { } while (0)
+
+#endif
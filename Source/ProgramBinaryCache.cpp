@@ -0,0 +1,147 @@
+//
+// COMP 371 Labs Framework
+//
+// On-disk cache of linked shader programs (glGetProgramBinary). Each program
+// has one file, named after its shaders, that stores a hash of the shader
+// sources and of the driver strings: an edited shader or a driver update
+// misses the cache and the new binary replaces the file.
+//
+
+#include "ProgramBinaryCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    const char PROGRAM_BINARY_MAGIC[4] = { 'P', 'R', 'G', 'B' };
+    const unsigned int PROGRAM_BINARY_VERSION = 1;
+
+    struct ProgramBinaryHeader
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned long long key;
+        unsigned int format;    // GLenum returned by glGetProgramBinary
+        unsigned int length;    // bytes of binary following the header
+    };
+
+    void hashBytes(unsigned long long& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    void hashString(unsigned long long& hash, const char* text)
+    {
+        // the terminator separates the strings, "ab" + "c" != "a" + "bc"
+        if (text != NULL)
+            hashBytes(hash, text, strlen(text) + 1);
+    }
+
+    // File name without its directory and extension
+    std::string shaderName(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        size_t begin = (slash == std::string::npos) ? 0 : slash + 1;
+        size_t dot = path.find_last_of('.');
+        size_t end = (dot == std::string::npos || dot < begin) ? path.size() : dot;
+        return path.substr(begin, end - begin);
+    }
+}
+
+bool isProgramBinarySupported()
+{
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+        return false;
+
+    // some drivers expose the entry points without any format (e.g. OSX)
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+unsigned long long programCacheKey(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    hashString(hash, vertexSource.c_str());
+    hashString(hash, fragmentSource.c_str());
+    hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hashString(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+std::string programCachePath(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
+{
+    size_t slash = vertexShaderPath.find_last_of("/\\");
+    std::string directory = (slash == std::string::npos) ? "" : vertexShaderPath.substr(0, slash + 1);
+    return directory + shaderName(vertexShaderPath) + "+" + shaderName(fragmentShaderPath) + ".programbin";
+}
+
+GLuint loadProgramBinary(const std::string& path, unsigned long long key)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+        return 0;
+
+    ProgramBinaryHeader header;
+    if (!file.read((char*)&header, sizeof(header))
+        || memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic)) != 0
+        || header.version != PROGRAM_BINARY_VERSION
+        || header.key != key
+        || header.length == 0)
+        return 0;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(&binary[0], binary.size()))
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, &binary[0], (GLsizei)binary.size());
+
+    // the driver may reject binaries from another build of itself
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool saveProgramBinary(const std::string& path, unsigned long long key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, &binary[0]);
+    if (length <= 0)
+        return false;
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_BINARY_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = (unsigned int)length;
+
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.write((const char*)&header, sizeof(header)) || !file.write(&binary[0], length))
+    {
+        std::cerr << "ERROR::SHADER::CACHE::WRITE_FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
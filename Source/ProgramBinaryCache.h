@@ -0,0 +1,32 @@
+//
+// COMP 371 Labs Framework
+//
+// On-disk cache of linked shader programs (glGetProgramBinary). Each program
+// has one file, named after its shaders, that stores a hash of the shader
+// sources and of the driver strings: an edited shader or a driver update
+// misses the cache and the new binary replaces the file.
+//
+
+#pragma once
+
+#include <string>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+// True when the context can save and restore program binaries in at least one format
+bool isProgramBinarySupported();
+
+// FNV-1a hash of both sources and of GL_VENDOR, GL_RENDERER and GL_VERSION
+unsigned long long programCacheKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+// "<vertex shader directory>/<vertex shader name>+<fragment shader name>.programbin",
+// the names without their extension
+std::string programCachePath(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+
+// Creates a linked program from a cache file, 0 when the file is missing,
+// was written for another key or is rejected by the driver
+GLuint loadProgramBinary(const std::string& path, unsigned long long key);
+
+// Writes the binary of a linked program over the file, false when the driver returns none
+bool saveProgramBinary(const std::string& path, unsigned long long key, GLuint program);
@@ -0,0 +1,42 @@
+//
+// COMP 371 Labs Framework
+//
+// Locates files under res/ whether the program runs from the repository root,
+// from VS2017/ (Visual Studio debugger) or from Bin/.
+//
+
+#include "ResourcePath.h"
+
+#include <fstream>
+
+bool fileExists(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    return file.good();
+}
+
+bool readTextFile(const std::string& path, std::string& text)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+        return false;
+
+    file.seekg(0, std::ios::end);
+    text.assign((size_t)file.tellg(), '\0');
+    file.seekg(0, std::ios::beg);
+    if (!text.empty())
+        file.read(&text[0], text.size());
+    return !file.fail();
+}
+
+std::string resolveResourcePath(const std::string& relativePath)
+{
+    const char* prefixes[] = { "", "../", "../../" };
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i)
+    {
+        std::string path = prefixes[i] + relativePath;
+        if (fileExists(path))
+            return path;
+    }
+    return relativePath;
+}
@@ -0,0 +1,19 @@
+//
+// COMP 371 Labs Framework
+//
+// Locates files under res/ whether the program runs from the repository root,
+// from VS2017/ (Visual Studio debugger) or from Bin/.
+//
+
+#pragma once
+
+#include <string>
+
+// Returns the first existing "<prefix><relativePath>" among the known prefixes,
+// or relativePath unchanged when none exists
+std::string resolveResourcePath(const std::string& relativePath);
+
+bool fileExists(const std::string& path);
+
+// Reads a whole file, false when it can't be opened
+bool readTextFile(const std::string& path, std::string& text);
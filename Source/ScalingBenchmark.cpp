@@ -0,0 +1,62 @@
+//
+// COMP 371 Labs Framework
+//
+// Results of the scene scaling benchmark, run with --bench-scaling, reported
+// as JSON.
+//
+
+#include "ScalingBenchmark.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Nearest rank of sorted values, 0 when there are none
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = (size_t)(fraction * sorted.size() + 0.999999);
+        return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+    }
+
+    double perFrame(double sum, size_t frames)
+    {
+        return frames > 0 ? sum / frames : 0.0;
+    }
+}
+
+void writeScalingReport(std::ostream& out, const std::vector<ScalingRun>& runs, int frames, int warmupFrames)
+{
+    out << "{\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"warmup_frames\": " << warmupFrames << ",\n";
+    out << "  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const ScalingRun& run = runs[i];
+        std::vector<double> sorted = run.frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        size_t measured = sorted.size();
+
+        out << (i > 0 ? ",\n" : "\n");
+        out << "    {\n";
+        out << "      \"target_parts\": " << run.targetParts << ",\n";
+        out << "      \"copies\": " << run.copies << ",\n";
+        out << "      \"parts\": " << run.parts << ",\n";
+        out << "      \"render_path\": \"" << run.renderPath << "\",\n";
+        out << "      \"render_path_used\": \"" << run.renderPathUsed << "\",\n";
+        out << "      \"exit_code\": " << run.exitCode << ",\n";
+        out << "      \"allocating_frames\": " << run.allocatingFrames << ",\n";
+        out << "      \"measured_frames\": " << measured << ",\n";
+        out << "      \"cpu_frame_ms\": { \"p50\": " << percentile(sorted, 0.50)
+            << ", \"p95\": " << percentile(sorted, 0.95)
+            << ", \"p99\": " << percentile(sorted, 0.99) << " },\n";
+        out << "      \"draw_calls\": " << perFrame(run.drawCalls, measured) << ",\n";
+        out << "      \"uniform_uploads\": " << perFrame(run.uniformUploads, measured) << ",\n";
+        out << "      \"triangles\": " << perFrame(run.triangles, measured) << "\n";
+        out << "    }";
+    }
+    out << "\n  ]\n";
+    out << "}" << std::endl;
+}
@@ -0,0 +1,33 @@
+//
+// COMP 371 Labs Framework
+//
+// Results of the scene scaling benchmark, run with --bench-scaling: the scene
+// replicated up to 1, 100, 10k and 1M parts, drawn headless along a fixed
+// camera path with every render path, reported as JSON.
+//
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One scene size drawn with one render path
+struct ScalingRun
+{
+    unsigned int targetParts = 0;   // size asked for, the scene is copied until it has at least that many parts
+    unsigned int copies = 0;
+    unsigned int parts = 0;
+    std::string renderPath;         // asked for
+    std::string renderPathUsed;     // at the end of the run: direct when the path is unsupported or overflowed
+    int exitCode = 0;               // of the run, not 0 when it failed or a frame allocated
+    int allocatingFrames = 0;
+    // frames after the warm-up
+    std::vector<double> frameTimes; // CPU milliseconds
+    double drawCalls = 0.0;         // sums over those frames
+    double uniformUploads = 0.0;
+    double triangles = 0.0;
+};
+
+// p50/p95/p99 CPU frame time and per-frame means of the counters of every run
+void writeScalingReport(std::ostream& out, const std::vector<ScalingRun>& runs, int frames, int warmupFrames);
@@ -0,0 +1,383 @@
+//
+// COMP 371 Labs Framework
+//
+// Scene description: models made of unit cube parts, loaded from a text file
+// under res/scenes/. The text is compiled once into a flat binary next to it
+// (<file>bin) which later runs memory-map directly.
+//
+
+#include "Scene.h"
+#include "TransformStore.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace
+{
+    const char SCENE_FILE_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+    const unsigned int SCENE_FILE_VERSION = 1;
+
+    struct SceneFileHeader
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned int modelCount;
+        unsigned int partCount;
+        long long sourceSize;   // size and modification time of the text file
+        long long sourceTime;   // the binary was compiled from
+    };
+
+    bool getFileStats(const std::string& path, long long& size, long long& time)
+    {
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) != 0)
+            return false;
+        size = (long long)fileStat.st_size;
+        time = (long long)fileStat.st_mtime;
+        return true;
+    }
+
+    // Minimal line tokenizer, the scene files are small enough to be read in one go
+    class SceneTokenizer
+    {
+    public:
+        SceneTokenizer(const char* begin, const char* end) : mCursor(begin), mEnd(end) {}
+
+        // Moves to the next token on the current line, returns false at the end of the line
+        bool next(std::string& token)
+        {
+            skipBlanks();
+            if (mCursor == mEnd || *mCursor == '\n' || *mCursor == '#')
+                return false;
+            const char* start = mCursor;
+            while (mCursor != mEnd && !isBlank(*mCursor) && *mCursor != '\n')
+                ++mCursor;
+            token.assign(start, mCursor);
+            return true;
+        }
+
+        bool nextFloat(float& value)
+        {
+            skipBlanks();
+            if (mCursor == mEnd || *mCursor == '\n')
+                return false;
+
+            // plain decimal notation only, strtof is locale aware and several times slower
+            const char* start = mCursor;
+            bool negative = false;
+            if (*mCursor == '-' || *mCursor == '+')
+                negative = *mCursor++ == '-';
+
+            double result = 0.0;
+            int digits = 0;
+            while (mCursor != mEnd && *mCursor >= '0' && *mCursor <= '9')
+            {
+                result = result * 10.0 + (*mCursor++ - '0');
+                ++digits;
+            }
+            if (mCursor != mEnd && *mCursor == '.')
+            {
+                ++mCursor;
+                double fraction = 0.1;
+                while (mCursor != mEnd && *mCursor >= '0' && *mCursor <= '9')
+                {
+                    result += (*mCursor++ - '0') * fraction;
+                    fraction *= 0.1;
+                    ++digits;
+                }
+            }
+            if (digits == 0 || (mCursor != mEnd && !isBlank(*mCursor) && *mCursor != '\n'))
+            {
+                mCursor = start;
+                return false;
+            }
+
+            value = (float)(negative ? -result : result);
+            return true;
+        }
+
+        bool nextVec3(glm::vec3& value)
+        {
+            return nextFloat(value.x) && nextFloat(value.y) && nextFloat(value.z);
+        }
+
+        // Skips the rest of the current line, returns false when there are no more lines
+        bool nextLine()
+        {
+            while (mCursor != mEnd && *mCursor != '\n')
+                ++mCursor;
+            if (mCursor == mEnd)
+                return false;
+            ++mCursor;
+            ++mLine;
+            return true;
+        }
+
+        int line() const { return mLine; }
+
+    private:
+        static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        void skipBlanks()
+        {
+            while (mCursor != mEnd && isBlank(*mCursor))
+                ++mCursor;
+        }
+
+        const char* mCursor;
+        const char* mEnd;
+        int mLine = 1;
+    };
+}
+
+Scene::Scene()
+    : mModels(NULL), mParts(NULL), mModelCount(0), mPartCount(0)
+{
+}
+
+int Scene::selectableModel(unsigned int n) const
+{
+    for (unsigned int i = 0; i < mModelCount; ++i)
+    {
+        if (mModels[i].selectable && n-- == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+void Scene::replicate(unsigned int copies, const glm::vec2& spacing)
+{
+    unsigned int columns = 1;
+    while (columns * columns < copies)
+        ++columns;
+
+    std::vector<SceneModel> models;
+    std::vector<ScenePart> parts;
+    models.reserve((size_t)copies * mModelCount);
+    parts.reserve((size_t)copies * mPartCount);
+    for (unsigned int copy = 0; copy < copies; ++copy)
+    {
+        glm::vec3 offset(spacing.x * (copy % columns), 0.0f, -spacing.y * (copy / columns));
+        for (unsigned int i = 0; i < mModelCount; ++i)
+        {
+            // parts are relative to their model, only the model moves
+            SceneModel model = mModels[i];
+            model.position += offset;
+            model.camera += offset;
+            model.selectable = (copy == 0) ? model.selectable : 0;
+            model.firstPart = (unsigned int)parts.size();
+            models.push_back(model);
+            parts.insert(parts.end(), mParts + mModels[i].firstPart, mParts + mModels[i].firstPart + mModels[i].partCount);
+        }
+    }
+
+    useInMemory(models, parts);
+    mFile.close();
+}
+
+bool Scene::parse(const std::string& path, std::vector<SceneModel>& models, std::vector<ScenePart>& parts)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "ERROR::SCENE::FILE_NOT_FOUND " << path << std::endl;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::string text((size_t)file.tellg(), '\0');
+    file.seekg(0, std::ios::beg);
+    if (!text.empty())
+        file.read(&text[0], text.size());
+
+    models.clear();
+    parts.clear();
+
+    // one part per line at most, avoids regrowing the arrays on big scenes
+    size_t lineCount = 1;
+    for (size_t i = 0; i < text.size(); ++i)
+        lineCount += text[i] == '\n';
+    parts.reserve(lineCount);
+
+    SceneTokenizer tokenizer(text.data(), text.data() + text.size());
+    std::string keyword, attribute;
+    do
+    {
+        if (!tokenizer.next(keyword))
+            continue;
+
+        if (keyword == "model")
+        {
+            SceneModel model;
+            memset(&model, 0, sizeof(model));
+            model.color = glm::vec3(1.0f, 1.0f, 1.0f);
+            model.firstPart = (unsigned int)parts.size();
+
+            std::string name;
+            if (!tokenizer.next(name) || name.size() >= SCENE_MODEL_NAME_LENGTH)
+            {
+                std::cerr << "ERROR::SCENE::PARSE " << path << ":" << tokenizer.line() << " model needs a name shorter than " << SCENE_MODEL_NAME_LENGTH << " characters" << std::endl;
+                return false;
+            }
+            memcpy(model.name, name.c_str(), name.size());
+
+            while (tokenizer.next(attribute))
+            {
+                bool valid = false;
+                if (attribute == "position")
+                    valid = tokenizer.nextVec3(model.position);
+                else if (attribute == "color")
+                    valid = tokenizer.nextVec3(model.color);
+                else if (attribute == "camera")
+                {
+                    valid = tokenizer.nextVec3(model.camera);
+                    model.selectable = 1;
+                }
+
+                if (!valid)
+                {
+                    std::cerr << "ERROR::SCENE::PARSE " << path << ":" << tokenizer.line() << " bad model attribute '" << attribute << "'" << std::endl;
+                    return false;
+                }
+            }
+            models.push_back(model);
+        }
+        else if (keyword == "part")
+        {
+            if (models.empty())
+            {
+                std::cerr << "ERROR::SCENE::PARSE " << path << ":" << tokenizer.line() << " part declared before any model" << std::endl;
+                return false;
+            }
+
+            ScenePart part;
+            part.translate = glm::vec3(0.0f);
+            part.rotate = glm::vec3(0.0f);
+            part.scale = glm::vec3(1.0f);
+            part.color = models.back().color;
+
+            while (tokenizer.next(attribute))
+            {
+                bool valid = false;
+                if (attribute == "translate")
+                    valid = tokenizer.nextVec3(part.translate);
+                else if (attribute == "rotate")
+                    valid = tokenizer.nextVec3(part.rotate);
+                else if (attribute == "scale")
+                    valid = tokenizer.nextVec3(part.scale);
+                else if (attribute == "color")
+                    valid = tokenizer.nextVec3(part.color);
+
+                if (!valid)
+                {
+                    std::cerr << "ERROR::SCENE::PARSE " << path << ":" << tokenizer.line() << " bad part attribute '" << attribute << "'" << std::endl;
+                    return false;
+                }
+            }
+
+            // part-local matrices never change, compose them once here instead of every frame
+            part.localMatrix = composeTransform(part.translate, part.rotate, part.scale);
+            parts.push_back(part);
+            models.back().partCount++;
+        }
+        else
+        {
+            std::cerr << "ERROR::SCENE::PARSE " << path << ":" << tokenizer.line() << " unknown keyword '" << keyword << "'" << std::endl;
+            return false;
+        }
+    } while (tokenizer.nextLine());
+
+    return true;
+}
+
+bool Scene::mapCompiled(const std::string& compiledPath, long long sourceSize, long long sourceTime)
+{
+    if (!mFile.open(compiledPath))
+        return false;
+
+    const SceneFileHeader* header = (const SceneFileHeader*)mFile.data();
+    bool valid = mFile.size() >= sizeof(SceneFileHeader)
+        && memcmp(header->magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) == 0
+        && header->version == SCENE_FILE_VERSION
+        && mFile.size() == sizeof(SceneFileHeader) + header->modelCount * sizeof(SceneModel) + header->partCount * sizeof(ScenePart)
+        && (sourceSize < 0 || (header->sourceSize == sourceSize && header->sourceTime == sourceTime));
+    if (!valid)
+    {
+        mFile.close();
+        return false;
+    }
+
+    const char* data = (const char*)mFile.data();
+    mModelCount = header->modelCount;
+    mPartCount = header->partCount;
+    mModels = (const SceneModel*)(data + sizeof(SceneFileHeader));
+    mParts = (const ScenePart*)(data + sizeof(SceneFileHeader) + mModelCount * sizeof(SceneModel));
+    return true;
+}
+
+void Scene::useInMemory(const std::vector<SceneModel>& models, const std::vector<ScenePart>& parts)
+{
+    mInMemoryData.resize(models.size() * sizeof(SceneModel) + parts.size() * sizeof(ScenePart) + 1);
+    if (!models.empty())
+        memcpy(&mInMemoryData[0], &models[0], models.size() * sizeof(SceneModel));
+    if (!parts.empty())
+        memcpy(&mInMemoryData[models.size() * sizeof(SceneModel)], &parts[0], parts.size() * sizeof(ScenePart));
+
+    mModelCount = (unsigned int)models.size();
+    mPartCount = (unsigned int)parts.size();
+    mModels = (const SceneModel*)&mInMemoryData[0];
+    mParts = (const ScenePart*)&mInMemoryData[models.size() * sizeof(SceneModel)];
+}
+
+bool Scene::load(const std::string& path)
+{
+    mFile.close();
+    mInMemoryData.clear();
+
+    std::string compiledPath = path + "bin";
+
+    long long sourceSize = -1, sourceTime = 0;
+    bool hasSource = getFileStats(path, sourceSize, sourceTime);
+
+    // up to date compiled scene, or only the compiled scene is shipped
+    if (mapCompiled(compiledPath, hasSource ? sourceSize : -1, sourceTime))
+        return true;
+
+    std::vector<SceneModel> models;
+    std::vector<ScenePart> parts;
+    if (!parse(path, models, parts))
+        return false;
+
+    SceneFileHeader header;
+    memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+    header.version = SCENE_FILE_VERSION;
+    header.modelCount = (unsigned int)models.size();
+    header.partCount = (unsigned int)parts.size();
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+
+    bool written = false;
+    {
+        std::ofstream compiled(compiledPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (compiled)
+        {
+            compiled.write((const char*)&header, sizeof(header));
+            if (!models.empty())
+                compiled.write((const char*)&models[0], models.size() * sizeof(SceneModel));
+            if (!parts.empty())
+                compiled.write((const char*)&parts[0], parts.size() * sizeof(ScenePart));
+            written = compiled.good();
+        }
+    }
+
+    if (written && mapCompiled(compiledPath, sourceSize, sourceTime))
+        return true;
+
+    // read-only resource directory, keep the parsed scene around instead
+    std::cerr << "Could not write compiled scene " << compiledPath << ", using it from memory" << std::endl;
+    useInMemory(models, parts);
+    return true;
+}
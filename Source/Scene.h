@@ -0,0 +1,77 @@
+//
+// COMP 371 Labs Framework
+//
+// Scene description: models made of unit cube parts, loaded from a text file
+// under res/scenes/. The text is compiled once into a flat binary next to it
+// (<file>bin) which later runs memory-map directly.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+
+const unsigned int SCENE_MODEL_NAME_LENGTH = 16;
+
+// Records below are stored as-is in the compiled file, keep them POD
+struct SceneModel
+{
+    char name[SCENE_MODEL_NAME_LENGTH];
+    glm::vec3 position;     // model origin in world space
+    glm::vec3 color;        // default color of the parts
+    glm::vec3 camera;       // camera position when the model is selected
+    unsigned int selectable;
+    unsigned int firstPart;
+    unsigned int partCount;
+};
+
+struct ScenePart
+{
+    glm::mat4 localMatrix;  // translate * rotate * scale, relative to the model
+    glm::vec3 translate;
+    glm::vec3 rotate;       // euler angles in degrees
+    glm::vec3 scale;
+    glm::vec3 color;
+};
+
+class Scene
+{
+public:
+    Scene();
+
+    // Maps the compiled scene, compiling the text file first when the binary
+    // is missing or older than the text. Errors are reported on std::cerr.
+    bool load(const std::string& path);
+
+    // Parses a scene text file without touching the compiled cache
+    static bool parse(const std::string& path, std::vector<SceneModel>& models, std::vector<ScenePart>& parts);
+
+    unsigned int modelCount() const { return mModelCount; }
+    unsigned int partCount() const { return mPartCount; }
+    const SceneModel& model(unsigned int index) const { return mModels[index]; }
+    const ScenePart& part(unsigned int index) const { return mParts[index]; }
+
+    // Index of the n-th selectable model, or -1
+    int selectableModel(unsigned int n) const;
+
+    // Replaces the scene with that many copies of it on a square grid of the
+    // x-z plane, spacing.x apart along x and spacing.y apart towards -z. Only
+    // the models of the first copy stay selectable. Nothing is written to disk.
+    void replicate(unsigned int copies, const glm::vec2& spacing);
+
+private:
+    bool mapCompiled(const std::string& compiledPath, long long sourceSize, long long sourceTime);
+    void useInMemory(const std::vector<SceneModel>& models, const std::vector<ScenePart>& parts);
+
+    MappedFile mFile;
+    std::vector<char> mInMemoryData;   // only used when the compiled file can't be written
+
+    const SceneModel* mModels;
+    const ScenePart* mParts;
+    unsigned int mModelCount;
+    unsigned int mPartCount;
+};
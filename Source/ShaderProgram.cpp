@@ -0,0 +1,264 @@
+//
+// COMP 371 Labs Framework
+//
+// Linked GLSL program with its active uniforms and attributes resolved once
+// after linking. Uniforms are set through their index in that table, and an
+// upload is only issued when the value differs from the last one sent.
+// Programs loaded from files are cached as driver binaries next to the shaders.
+//
+
+#include "ShaderProgram.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "ProgramBinaryCache.h"
+#include "ResourcePath.h"
+
+int compileAndLinkShaders(const char* vertexShaderSource, const char* fragmentShaderSource)
+{
+    // compile and link shader program
+    // return shader program id
+    // ------------------------------------
+
+    // vertex shader
+    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+
+    // check for shader compile errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    // fragment shader
+    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+    glCompileShader(fragmentShader);
+
+    // check for shader compile errors
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    // link shaders
+    int shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+        glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(shaderProgram);
+
+    // check for linking errors
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if (!success)
+    {
+        glDeleteProgram(shaderProgram);
+        return 0;
+    }
+
+    return shaderProgram;
+}
+
+ShaderProgram::ShaderProgram()
+    : mProgram(0), mLoadedFromCache(false)
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    destroy();
+}
+
+bool ShaderProgram::create(const char* vertexShaderSource, const char* fragmentShaderSource)
+{
+    GLuint program = (GLuint)compileAndLinkShaders(vertexShaderSource, fragmentShaderSource);
+    if (program == 0)
+        return false;
+
+    adopt(program);
+    return true;
+}
+
+bool ShaderProgram::createFromFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
+{
+    std::string vertexSource, fragmentSource;
+    if (!readTextFile(vertexShaderPath, vertexSource))
+    {
+        std::cerr << "ERROR::SHADER::VERTEX::FILE_NOT_FOUND " << vertexShaderPath << std::endl;
+        return false;
+    }
+    if (!readTextFile(fragmentShaderPath, fragmentSource))
+    {
+        std::cerr << "ERROR::SHADER::FRAGMENT::FILE_NOT_FOUND " << fragmentShaderPath << std::endl;
+        return false;
+    }
+
+    if (!isProgramBinarySupported())
+        return create(vertexSource.c_str(), fragmentSource.c_str());
+
+    unsigned long long key = programCacheKey(vertexSource, fragmentSource);
+    std::string cachePath = programCachePath(vertexShaderPath, fragmentShaderPath);
+
+    GLuint program = loadProgramBinary(cachePath, key);
+    if (program != 0)
+    {
+        adopt(program);
+        mLoadedFromCache = true;
+        return true;
+    }
+
+    // missing or out of date, the new binary replaces the file
+    if (!create(vertexSource.c_str(), fragmentSource.c_str()))
+        return false;
+    saveProgramBinary(cachePath, key, mProgram);
+    return true;
+}
+
+void ShaderProgram::adopt(GLuint program)
+{
+    destroy();
+    mProgram = program;
+    mLoadedFromCache = false;
+    resolveActiveVariables();
+}
+
+void ShaderProgram::destroy()
+{
+    if (mProgram == 0)
+        return;
+
+    GLStateCache::forgetProgram(mProgram);
+    glDeleteProgram(mProgram);
+    mProgram = 0;
+    mUniforms.clear();
+    mAttributes.clear();
+}
+
+void ShaderProgram::use() const
+{
+    GLStateCache::useProgram(mProgram);
+}
+
+void ShaderProgram::resolveActiveVariables()
+{
+    GLint count = 0;
+    char name[256];
+
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        Uniform uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(mProgram, i, sizeof(name), &length, &uniform.size, &uniform.type, name);
+        uniform.location = glGetUniformLocation(mProgram, name);
+        if (uniform.location < 0)
+            continue;   // uniform block members have no location
+
+        // arrays are reported as "name[0]", look them up without the suffix
+        uniform.name.assign(name, length);
+        if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.resize(uniform.name.size() - 3);
+        uniform.cached = false;
+        mUniforms.push_back(uniform);
+    }
+
+    glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTES, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        Attribute attribute;
+        GLsizei length = 0;
+        glGetActiveAttrib(mProgram, i, sizeof(name), &length, &attribute.size, &attribute.type, name);
+        attribute.name.assign(name, length);
+        attribute.location = glGetAttribLocation(mProgram, name);
+        mAttributes.push_back(attribute);
+    }
+}
+
+int ShaderProgram::uniformIndex(const char* name) const
+{
+    for (size_t i = 0; i < mUniforms.size(); ++i)
+    {
+        if (mUniforms[i].name == name)
+            return (int)i;
+    }
+    return -1;
+}
+
+GLint ShaderProgram::attributeLocation(const char* name) const
+{
+    for (size_t i = 0; i < mAttributes.size(); ++i)
+    {
+        if (mAttributes[i].name == name)
+            return mAttributes[i].location;
+    }
+    return -1;
+}
+
+bool ShaderProgram::bindUniformBlock(const char* name, GLuint binding)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(mProgram, name);
+    if (blockIndex == GL_INVALID_INDEX)
+        return false;
+
+    glUniformBlockBinding(mProgram, blockIndex, binding);
+    return true;
+}
+
+bool ShaderProgram::needsUpload(int index, const void* value, size_t size)
+{
+    Uniform& uniform = mUniforms[index];
+    if (uniform.cached && std::memcmp(uniform.value, value, size) == 0)
+    {
+        frameStats.uniformUploadsSkipped++;
+        return false;
+    }
+
+    std::memcpy(uniform.value, value, size);
+    uniform.cached = true;
+    frameStats.uniformUploads++;
+    use();
+    return true;
+}
+
+void ShaderProgram::setInt(int index, int value)
+{
+    if (index >= 0 && needsUpload(index, &value, sizeof(value)))
+        glUniform1i(mUniforms[index].location, value);
+}
+
+void ShaderProgram::setFloat(int index, float value)
+{
+    if (index >= 0 && needsUpload(index, &value, sizeof(value)))
+        glUniform1f(mUniforms[index].location, value);
+}
+
+void ShaderProgram::setVec3(int index, const glm::vec3& value)
+{
+    if (index >= 0 && needsUpload(index, &value[0], sizeof(value)))
+        glUniform3fv(mUniforms[index].location, 1, &value[0]);
+}
+
+void ShaderProgram::setMat4(int index, const glm::mat4& value)
+{
+    if (index >= 0 && needsUpload(index, &value[0][0], sizeof(value)))
+        glUniformMatrix4fv(mUniforms[index].location, 1, GL_FALSE, &value[0][0]);
+}
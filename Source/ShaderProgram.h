@@ -0,0 +1,96 @@
+//
+// COMP 371 Labs Framework
+//
+// Linked GLSL program with its active uniforms and attributes resolved once
+// after linking. Uniforms are set through their index in that table, and an
+// upload is only issued when the value differs from the last one sent.
+// Programs loaded from files are cached as driver binaries next to the shaders.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Compiles both stages and links them, errors are printed on std::cerr.
+// Returns the program id, or 0 when linking failed.
+int compileAndLinkShaders(const char* vertexShaderSource, const char* fragmentShaderSource);
+
+class ShaderProgram
+{
+public:
+    ShaderProgram();
+    ~ShaderProgram();
+
+    // Compiles and links, then builds the uniform and attribute tables
+    bool create(const char* vertexShaderSource, const char* fragmentShaderSource);
+
+    // Reads both stages from files. The linked program is restored from, or
+    // saved to, the program binary cache in the vertex shader's directory.
+    bool createFromFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+    void destroy();
+
+    // glUseProgram through GLStateCache, skipped when the program is already current
+    void use() const;
+
+    GLuint id() const { return mProgram; }
+    bool isValid() const { return mProgram != 0; }
+    bool loadedFromCache() const { return mLoadedFromCache; }
+
+    // Index in the uniform table, -1 when the uniform is not active.
+    // Resolve once, then pass the index to the setters every frame.
+    int uniformIndex(const char* name) const;
+    GLint attributeLocation(const char* name) const;
+
+    // Reads the named uniform block from a buffer binding point. Has to be
+    // called again after every create. False when the block is not active.
+    bool bindUniformBlock(const char* name, GLuint binding);
+
+    // The setters make the program current, an index of -1 is ignored
+    void setInt(int index, int value);
+    void setFloat(int index, float value);
+    void setVec3(int index, const glm::vec3& value);
+    void setMat4(int index, const glm::mat4& value);
+
+    size_t uniformCount() const { return mUniforms.size(); }
+    size_t attributeCount() const { return mAttributes.size(); }
+
+private:
+    ShaderProgram(const ShaderProgram&);
+    ShaderProgram& operator=(const ShaderProgram&);
+
+    struct Uniform
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size;             // array length, 1 for plain uniforms
+        bool cached;            // value holds the last uploaded value
+        unsigned char value[sizeof(glm::mat4)];
+    };
+
+    struct Attribute
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
+    void adopt(GLuint program);
+    void resolveActiveVariables();
+
+    // Stores the value and returns true when it differs from the cached one,
+    // counts the upload as issued or skipped
+    bool needsUpload(int index, const void* value, size_t size);
+
+    GLuint mProgram;
+    bool mLoadedFromCache;
+    std::vector<Uniform> mUniforms;
+    std::vector<Attribute> mAttributes;
+};
@@ -0,0 +1,135 @@
+//
+// COMP 371 Labs Framework
+//
+// Watches the shader directory from a background thread and raises a flag
+// when a .glsl file is written. The watcher only reports changes: the render
+// thread, which owns the GL context, checks the flag once per frame and
+// rebuilds the programs.
+// Only implemented with inotify on Linux, start() fails elsewhere.
+//
+
+#include "ShaderWatcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher()
+    : mChanged(false), mInotifyFile(-1)
+{
+    mWakePipe[0] = mWakePipe[1] = -1;
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    stop();
+}
+
+#if defined(__linux__)
+
+bool ShaderWatcher::start(const std::string& directory)
+{
+    stop();
+
+    mInotifyFile = inotify_init1(IN_CLOEXEC);
+    if (mInotifyFile < 0 || pipe(mWakePipe) != 0)
+    {
+        std::cerr << "ERROR::SHADER::WATCH::INIT_FAILED " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    // editors either rewrite the file in place or write a copy and rename it over
+    if (inotify_add_watch(mInotifyFile, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cerr << "ERROR::SHADER::WATCH::DIRECTORY " << directory << " " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    mThread = std::thread(&ShaderWatcher::run, this);
+    return true;
+}
+
+void ShaderWatcher::stop()
+{
+    if (mThread.joinable())
+    {
+        char wake = 1;
+        if (write(mWakePipe[1], &wake, 1) != 1)
+            std::cerr << "ERROR::SHADER::WATCH::STOP " << strerror(errno) << std::endl;
+        mThread.join();
+    }
+
+    if (mInotifyFile >= 0)
+        close(mInotifyFile);
+    for (int i = 0; i < 2; ++i)
+    {
+        if (mWakePipe[i] >= 0)
+            close(mWakePipe[i]);
+        mWakePipe[i] = -1;
+    }
+    mInotifyFile = -1;
+}
+
+void ShaderWatcher::run()
+{
+    // aligned as required for struct inotify_event
+    alignas(struct inotify_event) char buffer[4096];
+
+    for (;;)
+    {
+        pollfd files[2];
+        files[0].fd = mInotifyFile;
+        files[0].events = POLLIN;
+        files[1].fd = mWakePipe[0];
+        files[1].events = POLLIN;
+        if (poll(files, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (files[1].revents != 0)
+            return;
+
+        ssize_t length = read(mInotifyFile, buffer, sizeof(buffer));
+        if (length <= 0)
+            continue;
+
+        for (ssize_t offset = 0; offset < length; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            // the program binary cache lives in the same directory, only react to sources
+            size_t nameLength = event->len ? strlen(event->name) : 0;
+            if (nameLength > 5 && strcmp(event->name + nameLength - 5, ".glsl") == 0)
+                mChanged.store(true);
+        }
+    }
+}
+
+#else
+
+bool ShaderWatcher::start(const std::string& directory)
+{
+    std::cerr << "Shader hot-reload is only available on Linux, " << directory << " is not watched" << std::endl;
+    return false;
+}
+
+void ShaderWatcher::stop()
+{
+}
+
+void ShaderWatcher::run()
+{
+}
+
+#endif
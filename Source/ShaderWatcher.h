@@ -0,0 +1,43 @@
+//
+// COMP 371 Labs Framework
+//
+// Watches the shader directory from a background thread and raises a flag
+// when a .glsl file is written. The watcher only reports changes: the render
+// thread, which owns the GL context, checks the flag once per frame and
+// rebuilds the programs.
+// Only implemented with inotify on Linux, start() fails elsewhere.
+//
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    bool start(const std::string& directory);
+    void stop();
+
+    // True once after one or more shader files changed. A single relaxed
+    // load when nothing happened, so it can be called every frame.
+    bool hasChanges()
+    {
+        return mChanged.load(std::memory_order_relaxed) && mChanged.exchange(false);
+    }
+
+private:
+    ShaderWatcher(const ShaderWatcher&);
+    ShaderWatcher& operator=(const ShaderWatcher&);
+
+    void run();
+
+    std::thread mThread;
+    std::atomic<bool> mChanged;
+    int mInotifyFile;
+    int mWakePipe[2];   // written by stop() to unblock the watcher thread
+};
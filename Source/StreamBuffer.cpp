@@ -0,0 +1,199 @@
+//
+// COMP 371 Labs Framework
+//
+// Ring buffer for the data that is written once per frame and drawn right
+// away, e.g. instance attributes. The buffer is split into one region per
+// frame in flight and allocations are bumped inside the current region.
+//
+// With GL 4.4 or GL_ARB_buffer_storage the buffer is mapped persistently and
+// each region is guarded by a fence: the CPU only waits, and counts a stall,
+// when the GPU is still reading the region about to be reused. Older
+// contexts orphan the buffer when the ring wraps and map each allocation
+// unsynchronized instead.
+//
+
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "FrameStats.h"
+#include "GLStateCache.h"
+
+StreamBuffer::StreamBuffer()
+    : mTarget(GL_ARRAY_BUFFER), mBuffer(0), mPersistent(false), mMapped(NULL), mRangeMapped(false),
+      mFrameSize(0), mFrameCount(0), mFrame(0), mFrameUsed(0)
+{
+    for (unsigned int i = 0; i < MAX_FRAMES; ++i)
+        mFences[i] = NULL;
+    mStats.peakFrameBytes = 0;
+    mStats.stalls = 0;
+    mStats.stallSeconds = 0.0;
+    mStats.overflows = 0;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    destroy();
+}
+
+bool StreamBuffer::isPersistentSupported()
+{
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+bool StreamBuffer::create(GLenum target, size_t frameSize, unsigned int frameCount)
+{
+    destroy();
+
+    mTarget = target;
+    mFrameSize = frameSize;
+    mFrameCount = std::max(1u, std::min(frameCount, (unsigned int)MAX_FRAMES));
+    mFrame = mFrameCount - 1;   // the first beginFrame() moves to region 0
+    mFrameUsed = 0;
+    mPersistent = isPersistentSupported();
+
+    size_t totalSize = mFrameSize * mFrameCount;
+    glGenBuffers(1, &mBuffer);
+    GLStateCache::bindBuffer(mTarget, mBuffer);
+    if (mPersistent)
+    {
+        // coherent: writes are seen by the GPU without explicit flushes
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(mTarget, totalSize, NULL, flags);
+        mMapped = (unsigned char*)glMapBufferRange(mTarget, 0, totalSize, flags);
+        if (mMapped == NULL)
+        {
+            // immutable storage can't be respecified: orphan a fresh buffer instead
+            std::cerr << "ERROR::STREAM_BUFFER::MAP_FAILED falling back to orphaning" << std::endl;
+            GLStateCache::forgetBuffer(mBuffer);
+            glDeleteBuffers(1, &mBuffer);
+            mPersistent = false;
+            glGenBuffers(1, &mBuffer);
+            if (mBuffer == 0)
+                return false;
+            GLStateCache::bindBuffer(mTarget, mBuffer);
+        }
+    }
+    if (!mPersistent)
+    {
+        glBufferData(mTarget, totalSize, NULL, GL_STREAM_DRAW);
+    }
+    GLStateCache::bindBuffer(mTarget, 0);
+    return true;
+}
+
+void StreamBuffer::destroy()
+{
+    if (mBuffer == 0)
+        return;
+
+    for (unsigned int i = 0; i < MAX_FRAMES; ++i)
+    {
+        if (mFences[i] != NULL)
+            glDeleteSync(mFences[i]);
+        mFences[i] = NULL;
+    }
+
+    if (mMapped != NULL || mRangeMapped)
+    {
+        GLStateCache::bindBuffer(mTarget, mBuffer);
+        glUnmapBuffer(mTarget);
+    }
+    mMapped = NULL;
+    mRangeMapped = false;
+
+    GLStateCache::forgetBuffer(mBuffer);
+    glDeleteBuffers(1, &mBuffer);
+    mBuffer = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    if (mBuffer == 0)
+        return;
+
+    commit();
+    mFrame = (mFrame + 1) % mFrameCount;
+    mFrameUsed = 0;
+
+    if (mPersistent)
+    {
+        // the GPU may still read this region, written mFrameCount frames ago
+        GLsync fence = mFences[mFrame];
+        if (fence == NULL)
+            return;
+        mFences[mFrame] = NULL;
+
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            do
+            {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+            }
+            while (status == GL_TIMEOUT_EXPIRED);
+            mStats.stalls++;
+            mStats.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            frameStats.streamStalls++;
+        }
+        glDeleteSync(fence);
+    }
+    else if (mFrame == 0)
+    {
+        // the ring wrapped: the driver hands out fresh storage, the frames in flight keep the old one
+        GLStateCache::bindBuffer(mTarget, mBuffer);
+        glBufferData(mTarget, mFrameSize * mFrameCount, NULL, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::endFrame()
+{
+    if (mBuffer == 0)
+        return;
+
+    commit();
+    if (mPersistent)
+        mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* StreamBuffer::allocate(size_t size, size_t alignment, size_t& offset)
+{
+    if (mBuffer == 0)
+        return NULL;
+    commit();
+
+    size_t start = (mFrameUsed + alignment - 1) / alignment * alignment;
+    if (start + size > mFrameSize)
+    {
+        mStats.overflows++;
+        return NULL;
+    }
+
+    mFrameUsed = start + size;
+    mStats.peakFrameBytes = std::max(mStats.peakFrameBytes, mFrameUsed);
+    frameStats.bytesStreamed += (int)size;
+    offset = mFrame * mFrameSize + start;
+
+    if (mPersistent)
+        return mMapped + offset;
+
+    // nothing in flight uses this range: the region was orphaned or not written yet this time around
+    GLStateCache::bindBuffer(mTarget, mBuffer);
+    void* data = glMapBufferRange(mTarget, offset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    mRangeMapped = (data != NULL);
+    return data;
+}
+
+void StreamBuffer::commit()
+{
+    if (!mRangeMapped)
+        return;
+
+    GLStateCache::bindBuffer(mTarget, mBuffer);
+    glUnmapBuffer(mTarget);
+    mRangeMapped = false;
+}
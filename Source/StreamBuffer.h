@@ -0,0 +1,74 @@
+//
+// COMP 371 Labs Framework
+//
+// Ring buffer for the data that is written once per frame and drawn right
+// away, e.g. instance attributes. The buffer is split into one region per
+// frame in flight and allocations are bumped inside the current region.
+//
+// With GL 4.4 or GL_ARB_buffer_storage the buffer is mapped persistently and
+// each region is guarded by a fence: the CPU only waits, and counts a stall,
+// when the GPU is still reading the region about to be reused. Older
+// contexts orphan the buffer when the ring wraps and map each allocation
+// unsynchronized instead.
+//
+
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+struct StreamBufferStats
+{
+    size_t peakFrameBytes;  // most bytes allocated in one frame
+    unsigned int stalls;    // frames that waited for the GPU to release their region
+    double stallSeconds;    // time spent in those waits
+    unsigned int overflows; // allocations refused because the frame region was full
+};
+
+class StreamBuffer
+{
+public:
+    StreamBuffer();
+    ~StreamBuffer();
+
+    // frameCount regions of frameSize bytes each, bound to target while writing
+    bool create(GLenum target, size_t frameSize, unsigned int frameCount = 3);
+    void destroy();
+
+    // Moves to the next region, waiting until the GPU is done with it
+    void beginFrame();
+    // Fences the region of the frame, after its last draw
+    void endFrame();
+
+    // Reserves size bytes in the frame region, offset is where they start in
+    // buffer(). Returns where to write them, or NULL when the region is full.
+    void* allocate(size_t size, size_t alignment, size_t& offset);
+    // Makes the last allocation visible to GL, call before drawing from it
+    void commit();
+
+    GLuint buffer() const { return mBuffer; }
+    bool isPersistent() const { return mPersistent; }
+    size_t frameBytes() const { return mFrameUsed; }
+    const StreamBufferStats& stats() const { return mStats; }
+
+    // True when buffers can be mapped persistently (GL 4.4 or GL_ARB_buffer_storage)
+    static bool isPersistentSupported();
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    static const unsigned int MAX_FRAMES = 4;
+
+    GLenum mTarget;
+    GLuint mBuffer;
+    bool mPersistent;
+    unsigned char* mMapped;         // whole buffer when persistent
+    bool mRangeMapped;              // fallback: an allocation is mapped until commit()
+    size_t mFrameSize;
+    unsigned int mFrameCount;
+    unsigned int mFrame;            // region of the current frame
+    size_t mFrameUsed;              // bytes allocated in it
+    GLsync mFences[MAX_FRAMES];
+    StreamBufferStats mStats;
+};
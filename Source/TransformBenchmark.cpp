@@ -0,0 +1,130 @@
+//
+// COMP 371 Labs Framework
+//
+// Microbenchmark of the transform update, run with --bench-transforms:
+// scalar glm composition against the TransformStore batch kernels.
+//
+
+#include "TransformBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "TransformStore.h"
+
+namespace
+{
+    struct TransformInput
+    {
+        int parent;
+        RotationOrder order;
+        glm::vec3 translate;
+        glm::vec3 rotate;
+        glm::vec3 scale;
+    };
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Same shape as the scenes: a world root, models under it, parts under the models
+    void buildInputs(size_t count, std::vector<TransformInput>& inputs)
+    {
+        std::mt19937 random(371);
+        std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+        std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+        inputs.resize(count);
+        int model = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            TransformInput& input = inputs[i];
+            input.translate = glm::vec3(position(random), position(random), position(random));
+            input.rotate = glm::vec3(angle(random), angle(random), angle(random));
+            input.scale = glm::vec3(scale(random), scale(random), scale(random));
+
+            if (i == 0)
+            {
+                input.parent = -1;
+                input.order = ROTATE_XYZ;
+            }
+            else if (i % 8 == 1)
+            {
+                input.parent = 0;
+                input.order = ROTATE_YXZ;
+                model = (int)i;
+            }
+            else
+            {
+                input.parent = model;
+                input.order = ROTATE_XYZ;
+            }
+        }
+    }
+
+    // The path the hierarchy used before the store: one glm::mat4 at a time
+    void updateScalar(const std::vector<TransformInput>& inputs, std::vector<glm::mat4>& local, std::vector<glm::mat4>& world)
+    {
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            const TransformInput& input = inputs[i];
+            local[i] = composeTransform(input.translate, input.rotate, input.scale, input.order);
+            world[i] = (input.parent >= 0) ? world[input.parent] * local[i] : local[i];
+        }
+    }
+}
+
+int runTransformBenchmark(std::ostream& out)
+{
+    const size_t sizes[] = { 1000, 100000, 1000000 };
+
+    out << "transforms | scalar glm ms | SoA batch ms | speedup | max error" << std::endl;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        size_t count = sizes[s];
+
+        std::vector<TransformInput> inputs;
+        buildInputs(count, inputs);
+
+        std::vector<glm::mat4> scalarLocal(count), scalarWorld(count);
+        TransformStore store;
+        store.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            store.add(inputs[i].parent, inputs[i].translate, inputs[i].rotate, inputs[i].scale, inputs[i].order);
+
+        // best of several runs, roughly the same total work for every size
+        int runs = (int)std::max<size_t>(5, 2000000 / count);
+        double scalarMs = 1e30, batchMs = 1e30;
+        for (int run = 0; run < runs; ++run)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            updateScalar(inputs, scalarLocal, scalarWorld);
+            scalarMs = std::min(scalarMs, elapsedMs(start));
+
+            start = std::chrono::steady_clock::now();
+            store.composeLocalRange(0, count);
+            store.updateWorldRange(0, count);
+            batchMs = std::min(batchMs, elapsedMs(start));
+        }
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                for (int row = 0; row < 4; ++row)
+                    maxError = std::max(maxError, std::fabs(scalarWorld[i][column][row] - store.worldMatrix((unsigned int)i)[column][row]));
+            }
+        }
+
+        out << count << " | " << scalarMs << " | " << batchMs << " | " << (scalarMs / batchMs) << "x | " << maxError << std::endl;
+    }
+
+    return 0;
+}
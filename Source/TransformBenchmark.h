@@ -0,0 +1,13 @@
+//
+// COMP 371 Labs Framework
+//
+// Microbenchmark of the transform update, run with --bench-transforms:
+// scalar glm composition against the TransformStore batch kernels.
+//
+
+#pragma once
+
+#include <ostream>
+
+// Times both paths at 1k, 100k and 1M transforms and prints one line per size
+int runTransformBenchmark(std::ostream& out);
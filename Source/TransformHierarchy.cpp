@@ -0,0 +1,96 @@
+//
+// COMP 371 Labs Framework
+//
+// World -> model -> part transform tree on top of a TransformStore. Local and
+// world matrices are cached and only recomposed for the nodes whose transform
+// changed, and their children; the dirty nodes are batched through the
+// store's SIMD kernels.
+//
+
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+
+#include "JobSystem.h"
+
+TransformHierarchy::TransformHierarchy()
+    : mAnyDirty(false)
+{
+}
+
+int TransformHierarchy::addNode(int parent, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale, RotationOrder order)
+{
+    int node = (int)mStore.add(parent, translate, rotateDegrees, scale, order);
+    mLocalDirty.push_back(1);
+    mWorldChanged.push_back(0);
+    mAnyDirty = true;
+    return node;
+}
+
+void TransformHierarchy::setTransform(int node, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale)
+{
+    if (!mStore.set(node, translate, rotateDegrees, scale))
+        return;
+
+    mLocalDirty[node] = 1;
+    mAnyDirty = true;
+}
+
+int TransformHierarchy::update(JobSystem* jobs)
+{
+    // idle frames: nothing moved, no matrix is touched
+    if (!mAnyDirty)
+        return 0;
+
+    mComposeList.clear();
+    mWorldList.clear();
+
+    // nodes are stored parent first, so a single forward pass sees whether
+    // a parent's world matrix is going to change before visiting its children
+    for (size_t i = 0; i < mLocalDirty.size(); ++i)
+    {
+        int parent = mStore.parent((unsigned int)i);
+        bool parentChanged = parent >= 0 && mWorldChanged[parent];
+
+        if (mLocalDirty[i])
+        {
+            mComposeList.push_back((unsigned int)i);
+            mLocalDirty[i] = 0;
+        }
+        else if (!parentChanged)
+        {
+            mWorldChanged[i] = 0;
+            continue;
+        }
+
+        mWorldList.push_back((unsigned int)i);
+        mWorldChanged[i] = 1;
+    }
+
+    // all locals first, then the world products in parent-first order
+    if (!mComposeList.empty())
+    {
+        if (jobs != NULL)
+        {
+            // chunks of whole batches of four, so that only the last nodes of
+            // the list take the scalar path, as in a single call
+            const unsigned int* composeList = &mComposeList[0];
+            size_t count = mComposeList.size();
+            jobs->parallelFor(0, (count + 3) / 4, 256, [&](size_t begin, size_t end)
+            {
+                size_t first = 4 * begin;
+                size_t last = std::min(4 * end, count);
+                mStore.composeLocal(composeList + first, last - first);
+            });
+        }
+        else
+        {
+            mStore.composeLocal(&mComposeList[0], mComposeList.size());
+        }
+    }
+    if (!mWorldList.empty())
+        mStore.updateWorld(&mWorldList[0], mWorldList.size());
+
+    mAnyDirty = false;
+    return (int)(mComposeList.size() + mWorldList.size());
+}
@@ -0,0 +1,46 @@
+//
+// COMP 371 Labs Framework
+//
+// World -> model -> part transform tree on top of a TransformStore. Local and
+// world matrices are cached and only recomposed for the nodes whose transform
+// changed, and their children; the dirty nodes are batched through the
+// store's SIMD kernels.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TransformStore.h"
+
+class JobSystem;
+
+class TransformHierarchy
+{
+public:
+    TransformHierarchy();
+
+    // Parents must be added before their children, -1 for a root node
+    int addNode(int parent, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale, RotationOrder order = ROTATE_XYZ);
+
+    // Marks the node dirty only when the transform actually differs from the current one
+    void setTransform(int node, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale);
+
+    // Recomposes the dirty nodes and their subtrees, returns the number of matrices computed.
+    // With jobs, the local matrices are composed in parallel; the world
+    // products stay in one pass since they go parent first.
+    int update(JobSystem* jobs = NULL);
+
+    const glm::mat4& worldMatrix(int node) const { return mStore.worldMatrix(node); }
+    int nodeCount() const { return (int)mStore.size(); }
+
+private:
+    TransformStore mStore;
+    std::vector<unsigned char> mLocalDirty;     // local matrix needs to be recomposed
+    std::vector<unsigned char> mWorldChanged;   // scratch, world matrix was recomputed during update()
+    std::vector<unsigned int> mComposeList;     // scratch, nodes passed to the batch kernels
+    std::vector<unsigned int> mWorldList;
+    bool mAnyDirty;
+};
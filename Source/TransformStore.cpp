@@ -0,0 +1,367 @@
+//
+// COMP 371 Labs Framework
+//
+// Structure-of-arrays transform storage. Positions, euler angles and scales
+// live in separate 64-byte aligned float arrays so that the compose kernel
+// can load four transforms per SSE register; local and world matrices are
+// kept in aligned glm::mat4 arrays.
+//
+
+#include "TransformStore.h"
+
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_STORE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float DEGREES_TO_RADIANS = 0.017453292519943295f;
+}
+
+glm::mat4 composeTransform(const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale, RotationOrder order)
+{
+    glm::mat4 rotateX = glm::rotate(glm::mat4(1.0f), glm::radians(rotateDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    glm::mat4 rotateY = glm::rotate(glm::mat4(1.0f), glm::radians(rotateDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 rotateZ = glm::rotate(glm::mat4(1.0f), glm::radians(rotateDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 rotation = (order == ROTATE_XYZ) ? rotateX * rotateY * rotateZ : rotateY * rotateX * rotateZ;
+
+    return glm::translate(glm::mat4(1.0f), translate) * rotation * glm::scale(glm::mat4(1.0f), scale);
+}
+
+#pragma region SSE kernels
+#if TRANSFORM_STORE_SSE
+namespace
+{
+    // Cephes style sin/cos of four angles at once: reduce to [-pi/4, pi/4]
+    // around the nearest multiple of pi/4, then pick the sin or cos polynomial
+    // and the sign from the octant. Accurate to a few float ulps for the
+    // angles used here, far cheaper than four sinf + cosf calls.
+    inline void sinCos4(__m128 x, __m128& sinOut, __m128& cosOut)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+        __m128 sinSign = _mm_and_ps(x, signMask);
+        x = _mm_andnot_ps(signMask, x);
+
+        // octant, rounded up to an even number
+        __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+        octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(octant);
+
+        __m128 sinSwap = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+        __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+        __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+        sinSign = _mm_xor_ps(sinSign, sinSwap);
+
+        // x - y * pi/4 in three steps to keep the precision
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+        __m128 z = _mm_mul_ps(x, x);
+
+        __m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+        cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+        cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+        __m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+        sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+        __m128 sinValue = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+        __m128 cosValue = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+        sinOut = _mm_xor_ps(sinValue, sinSign);
+        cosOut = _mm_xor_ps(cosValue, cosSign);
+    }
+
+    inline __m128 select(__m128 mask, __m128 ifSet, __m128 ifClear)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+    }
+
+    // Builds four translate * rotation * scale matrices from one lane each.
+    // Both rotation orders are evaluated and blended with the order mask, so
+    // the kernel never branches per transform.
+    inline void compose4(__m128 tx, __m128 ty, __m128 tz,
+                         __m128 ax, __m128 ay, __m128 az,
+                         __m128 sx, __m128 sy, __m128 sz,
+                         __m128 yxzMask, glm::mat4* out[4])
+    {
+        const __m128 toRadians = _mm_set1_ps(DEGREES_TO_RADIANS);
+        __m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+        sinCos4(_mm_mul_ps(ax, toRadians), sinX, cosX);
+        sinCos4(_mm_mul_ps(ay, toRadians), sinY, cosY);
+        sinCos4(_mm_mul_ps(az, toRadians), sinZ, cosZ);
+
+        // Rx * Ry * Rz, row-major notation rRC
+        __m128 sxsy = _mm_mul_ps(sinX, sinY);
+        __m128 cxsy = _mm_mul_ps(cosX, sinY);
+        __m128 r00 = _mm_mul_ps(cosY, cosZ);
+        __m128 r01 = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cosY, sinZ));
+        __m128 r02 = sinY;
+        __m128 r10 = _mm_add_ps(_mm_mul_ps(sxsy, cosZ), _mm_mul_ps(cosX, sinZ));
+        __m128 r11 = _mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sxsy, sinZ));
+        __m128 r12 = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sinX, cosY));
+        __m128 r20 = _mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cxsy, cosZ));
+        __m128 r21 = _mm_add_ps(_mm_mul_ps(cxsy, sinZ), _mm_mul_ps(sinX, cosZ));
+        __m128 r22 = _mm_mul_ps(cosX, cosY);
+
+        // Ry * Rx * Rz
+        __m128 sysx = sxsy;
+        __m128 cysx = _mm_mul_ps(cosY, sinX);
+        __m128 q00 = _mm_add_ps(_mm_mul_ps(cosY, cosZ), _mm_mul_ps(sysx, sinZ));
+        __m128 q01 = _mm_sub_ps(_mm_mul_ps(sysx, cosZ), _mm_mul_ps(cosY, sinZ));
+        __m128 q02 = _mm_mul_ps(sinY, cosX);
+        __m128 q10 = _mm_mul_ps(cosX, sinZ);
+        __m128 q11 = _mm_mul_ps(cosX, cosZ);
+        __m128 q12 = _mm_sub_ps(_mm_setzero_ps(), sinX);
+        __m128 q20 = _mm_sub_ps(_mm_mul_ps(cysx, sinZ), _mm_mul_ps(sinY, cosZ));
+        __m128 q21 = _mm_add_ps(_mm_mul_ps(sinY, sinZ), _mm_mul_ps(cysx, cosZ));
+        __m128 q22 = r22;
+
+        // columns of the result: rotation columns scaled, then translation
+        __m128 c0x = _mm_mul_ps(select(yxzMask, q00, r00), sx);
+        __m128 c0y = _mm_mul_ps(select(yxzMask, q10, r10), sx);
+        __m128 c0z = _mm_mul_ps(select(yxzMask, q20, r20), sx);
+        __m128 c1x = _mm_mul_ps(select(yxzMask, q01, r01), sy);
+        __m128 c1y = _mm_mul_ps(select(yxzMask, q11, r11), sy);
+        __m128 c1z = _mm_mul_ps(select(yxzMask, q21, r21), sy);
+        __m128 c2x = _mm_mul_ps(select(yxzMask, q02, r02), sz);
+        __m128 c2y = _mm_mul_ps(select(yxzMask, q12, r12), sz);
+        __m128 c2z = _mm_mul_ps(select(yxzMask, q22, r22), sz);
+        __m128 zero = _mm_setzero_ps();
+        __m128 one = _mm_set1_ps(1.0f);
+
+        // lanes -> matrices: each transpose turns one column of four
+        // transforms into that column of each matrix
+        _MM_TRANSPOSE4_PS(c0x, c0y, c0z, zero);
+        _mm_store_ps(&(*out[0])[0][0], c0x);
+        _mm_store_ps(&(*out[1])[0][0], c0y);
+        _mm_store_ps(&(*out[2])[0][0], c0z);
+        _mm_store_ps(&(*out[3])[0][0], zero);
+
+        zero = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(c1x, c1y, c1z, zero);
+        _mm_store_ps(&(*out[0])[1][0], c1x);
+        _mm_store_ps(&(*out[1])[1][0], c1y);
+        _mm_store_ps(&(*out[2])[1][0], c1z);
+        _mm_store_ps(&(*out[3])[1][0], zero);
+
+        zero = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(c2x, c2y, c2z, zero);
+        _mm_store_ps(&(*out[0])[2][0], c2x);
+        _mm_store_ps(&(*out[1])[2][0], c2y);
+        _mm_store_ps(&(*out[2])[2][0], c2z);
+        _mm_store_ps(&(*out[3])[2][0], zero);
+
+        _MM_TRANSPOSE4_PS(tx, ty, tz, one);
+        _mm_store_ps(&(*out[0])[3][0], tx);
+        _mm_store_ps(&(*out[1])[3][0], ty);
+        _mm_store_ps(&(*out[2])[3][0], tz);
+        _mm_store_ps(&(*out[3])[3][0], one);
+    }
+
+    // out = a * b, column-major, one column of the result per iteration
+    inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+    {
+        __m128 a0 = _mm_load_ps(&a[0][0]);
+        __m128 a1 = _mm_load_ps(&a[1][0]);
+        __m128 a2 = _mm_load_ps(&a[2][0]);
+        __m128 a3 = _mm_load_ps(&a[3][0]);
+
+        for (int column = 0; column < 4; ++column)
+        {
+            __m128 b0 = _mm_load_ps(&b[column][0]);
+            __m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(0, 0, 0, 0)));
+            result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(1, 1, 1, 1))));
+            result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(2, 2, 2, 2))));
+            result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(3, 3, 3, 3))));
+            _mm_store_ps(&out[column][0], result);
+        }
+    }
+}
+#endif
+#pragma endregion
+
+unsigned int TransformStore::add(int parent, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale, RotationOrder order)
+{
+    unsigned int index = (unsigned int)mParents.size();
+    if (parent >= (int)index)
+        parent = -1;    // parents always come first, see updateWorld()
+
+    mParents.push_back(parent);
+    mOrderMasks.push_back(order == ROTATE_YXZ ? 0xFFFFFFFFu : 0u);
+    mPositionX.push_back(translate.x);
+    mPositionY.push_back(translate.y);
+    mPositionZ.push_back(translate.z);
+    mAngleX.push_back(rotateDegrees.x);
+    mAngleY.push_back(rotateDegrees.y);
+    mAngleZ.push_back(rotateDegrees.z);
+    mScaleX.push_back(scale.x);
+    mScaleY.push_back(scale.y);
+    mScaleZ.push_back(scale.z);
+    mLocalMatrices.push_back(glm::mat4(1.0f));
+    mWorldMatrices.push_back(glm::mat4(1.0f));
+    return index;
+}
+
+void TransformStore::reserve(size_t count)
+{
+    mParents.reserve(count);
+    mOrderMasks.reserve(count);
+    mPositionX.reserve(count);
+    mPositionY.reserve(count);
+    mPositionZ.reserve(count);
+    mAngleX.reserve(count);
+    mAngleY.reserve(count);
+    mAngleZ.reserve(count);
+    mScaleX.reserve(count);
+    mScaleY.reserve(count);
+    mScaleZ.reserve(count);
+    mLocalMatrices.reserve(count);
+    mWorldMatrices.reserve(count);
+}
+
+void TransformStore::clear()
+{
+    mParents.clear();
+    mOrderMasks.clear();
+    mPositionX.clear();
+    mPositionY.clear();
+    mPositionZ.clear();
+    mAngleX.clear();
+    mAngleY.clear();
+    mAngleZ.clear();
+    mScaleX.clear();
+    mScaleY.clear();
+    mScaleZ.clear();
+    mLocalMatrices.clear();
+    mWorldMatrices.clear();
+}
+
+bool TransformStore::set(unsigned int index, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale)
+{
+    if (mPositionX[index] == translate.x && mPositionY[index] == translate.y && mPositionZ[index] == translate.z &&
+        mAngleX[index] == rotateDegrees.x && mAngleY[index] == rotateDegrees.y && mAngleZ[index] == rotateDegrees.z &&
+        mScaleX[index] == scale.x && mScaleY[index] == scale.y && mScaleZ[index] == scale.z)
+        return false;
+
+    mPositionX[index] = translate.x;
+    mPositionY[index] = translate.y;
+    mPositionZ[index] = translate.z;
+    mAngleX[index] = rotateDegrees.x;
+    mAngleY[index] = rotateDegrees.y;
+    mAngleZ[index] = rotateDegrees.z;
+    mScaleX[index] = scale.x;
+    mScaleY[index] = scale.y;
+    mScaleZ[index] = scale.z;
+    return true;
+}
+
+void TransformStore::composeScalar(unsigned int i)
+{
+    float sinX = std::sin(mAngleX[i] * DEGREES_TO_RADIANS), cosX = std::cos(mAngleX[i] * DEGREES_TO_RADIANS);
+    float sinY = std::sin(mAngleY[i] * DEGREES_TO_RADIANS), cosY = std::cos(mAngleY[i] * DEGREES_TO_RADIANS);
+    float sinZ = std::sin(mAngleZ[i] * DEGREES_TO_RADIANS), cosZ = std::cos(mAngleZ[i] * DEGREES_TO_RADIANS);
+
+    // rotation rows, same closed forms as compose4()
+    glm::vec3 row0, row1, row2;
+    if (mOrderMasks[i])
+    {
+        row0 = glm::vec3(cosY * cosZ + sinY * sinX * sinZ, sinY * sinX * cosZ - cosY * sinZ, sinY * cosX);
+        row1 = glm::vec3(cosX * sinZ, cosX * cosZ, -sinX);
+        row2 = glm::vec3(cosY * sinX * sinZ - sinY * cosZ, sinY * sinZ + cosY * sinX * cosZ, cosY * cosX);
+    }
+    else
+    {
+        row0 = glm::vec3(cosY * cosZ, -cosY * sinZ, sinY);
+        row1 = glm::vec3(sinX * sinY * cosZ + cosX * sinZ, cosX * cosZ - sinX * sinY * sinZ, -sinX * cosY);
+        row2 = glm::vec3(sinX * sinZ - cosX * sinY * cosZ, cosX * sinY * sinZ + sinX * cosZ, cosX * cosY);
+    }
+
+    glm::mat4& m = mLocalMatrices[i];
+    m[0] = glm::vec4(row0.x * mScaleX[i], row1.x * mScaleX[i], row2.x * mScaleX[i], 0.0f);
+    m[1] = glm::vec4(row0.y * mScaleY[i], row1.y * mScaleY[i], row2.y * mScaleY[i], 0.0f);
+    m[2] = glm::vec4(row0.z * mScaleZ[i], row1.z * mScaleZ[i], row2.z * mScaleZ[i], 0.0f);
+    m[3] = glm::vec4(mPositionX[i], mPositionY[i], mPositionZ[i], 1.0f);
+}
+
+void TransformStore::multiplyWorld(unsigned int i)
+{
+    int parent = mParents[i];
+    if (parent < 0)
+    {
+        mWorldMatrices[i] = mLocalMatrices[i];
+        return;
+    }
+
+#if TRANSFORM_STORE_SSE
+    multiply(mWorldMatrices[parent], mLocalMatrices[i], mWorldMatrices[i]);
+#else
+    mWorldMatrices[i] = mWorldMatrices[parent] * mLocalMatrices[i];
+#endif
+}
+
+void TransformStore::composeLocalRange(size_t begin, size_t end)
+{
+    size_t i = begin;
+#if TRANSFORM_STORE_SSE
+    // contiguous range: straight unaligned loads, begin may not be a multiple of 4
+    for (; i + 4 <= end; i += 4)
+    {
+        glm::mat4* out[4] = { &mLocalMatrices[i], &mLocalMatrices[i + 1], &mLocalMatrices[i + 2], &mLocalMatrices[i + 3] };
+        compose4(_mm_loadu_ps(&mPositionX[i]), _mm_loadu_ps(&mPositionY[i]), _mm_loadu_ps(&mPositionZ[i]),
+                 _mm_loadu_ps(&mAngleX[i]), _mm_loadu_ps(&mAngleY[i]), _mm_loadu_ps(&mAngleZ[i]),
+                 _mm_loadu_ps(&mScaleX[i]), _mm_loadu_ps(&mScaleY[i]), _mm_loadu_ps(&mScaleZ[i]),
+                 _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&mOrderMasks[i])), out);
+    }
+#endif
+    for (; i < end; ++i)
+        composeScalar((unsigned int)i);
+}
+
+void TransformStore::composeLocal(const unsigned int* indices, size_t count)
+{
+    size_t n = 0;
+#if TRANSFORM_STORE_SSE
+    // scattered dirty nodes: gather four lanes at a time
+    for (; n + 4 <= count; n += 4)
+    {
+        unsigned int i0 = indices[n], i1 = indices[n + 1], i2 = indices[n + 2], i3 = indices[n + 3];
+        glm::mat4* out[4] = { &mLocalMatrices[i0], &mLocalMatrices[i1], &mLocalMatrices[i2], &mLocalMatrices[i3] };
+        compose4(_mm_setr_ps(mPositionX[i0], mPositionX[i1], mPositionX[i2], mPositionX[i3]),
+                 _mm_setr_ps(mPositionY[i0], mPositionY[i1], mPositionY[i2], mPositionY[i3]),
+                 _mm_setr_ps(mPositionZ[i0], mPositionZ[i1], mPositionZ[i2], mPositionZ[i3]),
+                 _mm_setr_ps(mAngleX[i0], mAngleX[i1], mAngleX[i2], mAngleX[i3]),
+                 _mm_setr_ps(mAngleY[i0], mAngleY[i1], mAngleY[i2], mAngleY[i3]),
+                 _mm_setr_ps(mAngleZ[i0], mAngleZ[i1], mAngleZ[i2], mAngleZ[i3]),
+                 _mm_setr_ps(mScaleX[i0], mScaleX[i1], mScaleX[i2], mScaleX[i3]),
+                 _mm_setr_ps(mScaleY[i0], mScaleY[i1], mScaleY[i2], mScaleY[i3]),
+                 _mm_setr_ps(mScaleZ[i0], mScaleZ[i1], mScaleZ[i2], mScaleZ[i3]),
+                 _mm_castsi128_ps(_mm_setr_epi32((int)mOrderMasks[i0], (int)mOrderMasks[i1], (int)mOrderMasks[i2], (int)mOrderMasks[i3])),
+                 out);
+    }
+#endif
+    for (; n < count; ++n)
+        composeScalar(indices[n]);
+}
+
+void TransformStore::updateWorldRange(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+        multiplyWorld((unsigned int)i);
+}
+
+void TransformStore::updateWorld(const unsigned int* indices, size_t count)
+{
+    for (size_t n = 0; n < count; ++n)
+        multiplyWorld(indices[n]);
+}
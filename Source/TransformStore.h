@@ -0,0 +1,66 @@
+//
+// COMP 371 Labs Framework
+//
+// Structure-of-arrays transform storage. Positions, euler angles and scales
+// live in separate 64-byte aligned float arrays so that the compose kernel
+// can load four transforms per SSE register; local and world matrices are
+// kept in aligned glm::mat4 arrays.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AlignedAllocator.h"
+
+// Order in which the euler angles are applied, as a matrix product
+enum RotationOrder
+{
+    ROTATE_XYZ, // Rx * Ry * Rz
+    ROTATE_YXZ  // Ry * Rx * Rz
+};
+
+// translate * rotation (degrees) * scale, scalar glm reference
+glm::mat4 composeTransform(const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale, RotationOrder order = ROTATE_XYZ);
+
+class TransformStore
+{
+public:
+    typedef std::vector<float, AlignedAllocator<float, 64> > FloatArray;
+    typedef std::vector<glm::mat4, AlignedAllocator<glm::mat4, 64> > MatrixArray;
+
+    // Parents must be added before their children, -1 for a root
+    unsigned int add(int parent, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale, RotationOrder order = ROTATE_XYZ);
+    void reserve(size_t count);
+    void clear();
+
+    // Returns false when the transform was already equal to the given one
+    bool set(unsigned int index, const glm::vec3& translate, const glm::vec3& rotateDegrees, const glm::vec3& scale);
+
+    // local = translate * rotation * scale, four transforms per iteration
+    void composeLocalRange(size_t begin, size_t end);
+    void composeLocal(const unsigned int* indices, size_t count);
+
+    // world = parent world * local, in the given order (parents first)
+    void updateWorldRange(size_t begin, size_t end);
+    void updateWorld(const unsigned int* indices, size_t count);
+
+    size_t size() const { return mParents.size(); }
+    int parent(unsigned int index) const { return mParents[index]; }
+    const glm::mat4& localMatrix(unsigned int index) const { return mLocalMatrices[index]; }
+    const glm::mat4& worldMatrix(unsigned int index) const { return mWorldMatrices[index]; }
+
+private:
+    void composeScalar(unsigned int index);
+    void multiplyWorld(unsigned int index);
+
+    std::vector<int> mParents;
+    std::vector<unsigned int> mOrderMasks;  // all bits set for ROTATE_YXZ, used as an SSE blend mask
+    FloatArray mPositionX, mPositionY, mPositionZ;
+    FloatArray mAngleX, mAngleY, mAngleZ;   // degrees
+    FloatArray mScaleX, mScaleY, mScaleZ;
+    MatrixArray mLocalMatrices;
+    MatrixArray mWorldMatrices;
+};
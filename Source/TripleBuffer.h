@@ -0,0 +1,68 @@
+//
+// COMP 371 Labs Framework
+//
+// Lock-free handoff from one producer thread to one consumer thread. Each
+// side has a slot of its own and the third one is shared: publish() and
+// acquire() swap the caller's slot with the shared one in a single atomic
+// exchange, so the producer fills the next value while the consumer still
+// reads the previous one. A value published before the last one was acquired
+// replaces it; a producer that must not drop values waits for !isPending().
+//
+
+#pragma once
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : mShared(1), mWrite(0), mRead(2)
+    {
+    }
+
+    // Producer: the slot to fill, invisible to the consumer until publish().
+    // It holds whatever value was last in it, containers keep their capacity.
+    T& writeSlot() { return mSlots[mWrite]; }
+
+    // Producer: hands the filled slot over and takes the shared one to fill next
+    void publish()
+    {
+        unsigned int previous = mShared.exchange(mWrite | FRESH, std::memory_order_acq_rel);
+        mWrite = previous & INDEX_MASK;
+    }
+
+    // Producer: true while the last published value was not acquired yet
+    bool isPending() const
+    {
+        return (mShared.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+    // Consumer: takes the last published value, false when there is no new one
+    bool acquire()
+    {
+        if ((mShared.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        unsigned int previous = mShared.exchange(mRead, std::memory_order_acq_rel);
+        mRead = previous & INDEX_MASK;
+        return true;
+    }
+
+    // Consumer: the acquired value, unchanged until the next acquire()
+    const T& readSlot() const { return mSlots[mRead]; }
+
+private:
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int FRESH = 4;  // set by publish(), cleared by acquire()
+
+    T mSlots[3];
+
+    // the shared index and each side's own index on separate cache lines
+    alignas(64) std::atomic<unsigned int> mShared;
+    alignas(64) unsigned int mWrite;
+    alignas(64) unsigned int mRead;
+};
@@ -0,0 +1,219 @@
+//
+// COMP 371 Labs Framework
+//
+// Triangle reordering for the post-transform vertex cache, after Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation", and the average cache
+// miss ratio (ACMR) used to measure it: vertex shader runs per triangle,
+// 3.0 for unindexed triangles, down to about 0.5 for large regular meshes.
+//
+
+#include "VertexCacheOptimizer.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    // LRU cache modelled by the scores, larger than real FIFOs on purpose
+    const int MODEL_CACHE_SIZE = 32;
+
+    const unsigned int VALENCE_TABLE_SIZE = 32;
+
+    // Favors vertices used by the last triangles, and vertices with few
+    // triangles left so that no isolated triangle is left behind. Both terms
+    // are tabulated, powf would dominate the run time.
+    struct ScoreTables
+    {
+        float cache[MODEL_CACHE_SIZE];
+        float valence[VALENCE_TABLE_SIZE];
+
+        ScoreTables()
+        {
+            for (int i = 0; i < MODEL_CACHE_SIZE; ++i)
+            {
+                // the last triangle's vertices, lowered so the next triangle isn't forced to share an edge
+                if (i < 3)
+                    cache[i] = 0.75f;
+                else
+                    cache[i] = powf(1.0f - (float)(i - 3) / (MODEL_CACHE_SIZE - 3), 1.5f);
+            }
+            valence[0] = 0.0f;
+            for (unsigned int i = 1; i < VALENCE_TABLE_SIZE; ++i)
+                valence[i] = 2.0f * powf((float)i, -0.5f);
+        }
+    };
+
+    float vertexScore(const ScoreTables& tables, int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = (cachePosition >= 0) ? tables.cache[cachePosition] : 0.0f;
+        if (remainingTriangles < VALENCE_TABLE_SIZE)
+            score += tables.valence[remainingTriangles];
+        else
+            score += 2.0f * powf((float)remainingTriangles, -0.5f);
+        return score;
+    }
+
+    // Whether the corner at index i repeats a vertex of its own triangle
+    bool repeatsEarlierCorner(const unsigned int* indices, size_t i)
+    {
+        size_t first = i - i % 3;
+        for (size_t j = first; j < i; ++j)
+            if (indices[j] == indices[i])
+                return true;
+        return false;
+    }
+}
+
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of every vertex, packed: vertex v owns adjacency[offsets[v]] to
+    // adjacency[offsets[v] + remaining[v]], emitted triangles are swapped out
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    // a degenerate triangle lists its repeated vertex once
+    std::vector<unsigned int> adjacency(3 * triangleCount);
+    for (size_t i = 0; i < 3 * triangleCount; ++i)
+        if (!repeatsEarlierCorner(indices, i))
+            remaining[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    {
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < 3 * triangleCount; ++i)
+            if (!repeatsEarlierCorner(indices, i))
+                adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    static const ScoreTables tables;
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vertexScores[v] = vertexScore(tables, -1, remaining[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    int bestTriangle = 0;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const unsigned int* triangle = &indices[3 * t];
+        triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = (int)t;
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(3 * triangleCount);
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(MODEL_CACHE_SIZE + 3);
+    nextCache.reserve(MODEL_CACHE_SIZE + 3);
+    size_t scanPosition = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        // nothing left around the cache: continue with the first triangle not emitted yet
+        if (bestTriangle < 0)
+        {
+            while (emitted[scanPosition])
+                scanPosition++;
+            bestTriangle = (int)scanPosition;
+        }
+
+        const unsigned int* triangle = &indices[3 * bestTriangle];
+        emitted[bestTriangle] = true;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = triangle[k];
+            output.push_back(v);
+            if (repeatsEarlierCorner(indices, 3 * bestTriangle + k))
+                continue;
+
+            unsigned int* begin = &adjacency[offsets[v]];
+            for (unsigned int i = 0; i < remaining[v]; ++i)
+            {
+                if (begin[i] == (unsigned int)bestTriangle)
+                {
+                    begin[i] = begin[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front, the others shift back
+        nextCache.clear();
+        for (int k = 0; k < 3; ++k)
+            if (!repeatsEarlierCorner(indices, 3 * bestTriangle + k))
+                nextCache.push_back(triangle[k]);
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            unsigned int v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        }
+
+        // rescore the vertices that moved, including those pushed out, then
+        // pick the best triangle among the ones they still belong to
+        for (size_t i = 0; i < nextCache.size(); ++i)
+        {
+            unsigned int v = nextCache[i];
+            cachePositions[v] = (i < (size_t)MODEL_CACHE_SIZE) ? (int)i : -1;
+            vertexScores[v] = vertexScore(tables, cachePositions[v], remaining[v]);
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < nextCache.size(); ++i)
+        {
+            unsigned int v = nextCache[i];
+            for (unsigned int j = 0; j < remaining[v]; ++j)
+            {
+                unsigned int t = adjacency[offsets[v] + j];
+                const unsigned int* other = &indices[3 * t];
+                triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = (int)t;
+                }
+            }
+        }
+
+        if (nextCache.size() > (size_t)MODEL_CACHE_SIZE)
+            nextCache.resize(MODEL_CACHE_SIZE);
+        cache.swap(nextCache);
+    }
+
+    for (size_t i = 0; i < output.size(); ++i)
+        indices[i] = output[i];
+}
+
+float computeAcmr(const unsigned int* indices, size_t indexCount, unsigned int cacheSize)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || cacheSize == 0)
+        return 0.0f;
+
+    std::vector<unsigned int> fifo(cacheSize, ~0u);
+    unsigned int next = 0;
+    size_t misses = 0;
+    for (size_t i = 0; i < 3 * triangleCount; ++i)
+    {
+        bool hit = false;
+        for (unsigned int j = 0; j < cacheSize && !hit; ++j)
+            hit = (fifo[j] == indices[i]);
+        if (hit)
+            continue;
+
+        misses++;
+        fifo[next] = indices[i];
+        next = (next + 1) % cacheSize;
+    }
+    return (float)misses / triangleCount;
+}
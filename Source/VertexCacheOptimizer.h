@@ -0,0 +1,18 @@
+//
+// COMP 371 Labs Framework
+//
+// Triangle reordering for the post-transform vertex cache, after Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation", and the average cache
+// miss ratio (ACMR) used to measure it: vertex shader runs per triangle,
+// 3.0 for unindexed triangles, down to about 0.5 for large regular meshes.
+//
+
+#pragma once
+
+#include <cstddef>
+
+// Reorders the triangles of an indexed triangle list in place, all indices < vertexCount
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// Misses per triangle of a FIFO cache of the given size, as on most GPUs
+float computeAcmr(const unsigned int* indices, size_t indexCount, unsigned int cacheSize = 16);
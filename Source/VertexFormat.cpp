@@ -0,0 +1,175 @@
+//
+// COMP 371 Labs Framework
+//
+// Vertex layouts of the meshes, from plain floats to packed attributes:
+// half-float or 16-bit integer positions, RGBA8 colors and 2_10_10_10
+// normals. Meshes are described with MeshVertex and encoded when they are
+// uploaded; integer positions are scaled to the mesh bounds and come with a
+// dequantization matrix that maps them back to model space.
+//
+
+#include "VertexFormat.h"
+
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+
+namespace
+{
+    size_t positionSize(PositionEncoding encoding)
+    {
+        return (encoding == POSITION_FLOAT) ? 3 * sizeof(float) : 4 * sizeof(GLshort);
+    }
+
+    size_t colorSize(ColorEncoding encoding)
+    {
+        switch (encoding)
+        {
+        case COLOR_FLOAT: return 3 * sizeof(float);
+        case COLOR_UNORM8: return 4;
+        default: return 0;
+        }
+    }
+
+    size_t normalSize(NormalEncoding encoding)
+    {
+        switch (encoding)
+        {
+        case NORMAL_FLOAT: return 3 * sizeof(float);
+        case NORMAL_INT_2_10_10_10: return 4;
+        default: return 0;
+        }
+    }
+
+    // largest GL_SHORT magnitude used, symmetric so that 0 stays exact
+    const float SHORT_RANGE = 32767.0f;
+}
+
+VertexFormat VertexFormat::full(bool hasNormals)
+{
+    VertexFormat format = { POSITION_FLOAT, COLOR_FLOAT, hasNormals ? NORMAL_FLOAT : NORMAL_NONE };
+    return format;
+}
+
+VertexFormat VertexFormat::packed(bool hasNormals)
+{
+    VertexFormat format = { POSITION_SHORT, COLOR_UNORM8, hasNormals ? NORMAL_INT_2_10_10_10 : NORMAL_NONE };
+    return format;
+}
+
+size_t VertexFormat::stride() const
+{
+    return positionSize(position) + colorSize(color) + normalSize(normal);
+}
+
+void encodeVertices(const VertexFormat& format, const MeshVertex* vertices, size_t count,
+    std::vector<unsigned char>& out, glm::mat4& dequantization)
+{
+    size_t stride = format.stride();
+    out.assign(count * stride, 0);
+    dequantization = glm::mat4(1.0f);
+
+    // GL_SHORT positions are integers spread over the bounds: position = center + stored * scale.
+    // Not normalized, so the conversion to float is exact whatever the GL version.
+    glm::vec3 center(0.0f), scale(1.0f);
+    if (format.position == POSITION_SHORT && count > 0)
+    {
+        glm::vec3 lower = vertices[0].position, upper = vertices[0].position;
+        for (size_t i = 1; i < count; ++i)
+        {
+            lower = glm::min(lower, vertices[i].position);
+            upper = glm::max(upper, vertices[i].position);
+        }
+        center = 0.5f * (lower + upper);
+        scale = glm::max(0.5f * (upper - lower), glm::vec3(1e-30f)) / SHORT_RANGE;
+        dequantization = glm::scale(glm::translate(glm::mat4(1.0f), center), scale);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const MeshVertex& vertex = vertices[i];
+        unsigned char* record = &out[i * stride];
+
+        switch (format.position)
+        {
+        case POSITION_FLOAT:
+            memcpy(record, &vertex.position, 3 * sizeof(float));
+            break;
+        case POSITION_HALF:
+        {
+            glm::uint64 packed = glm::packHalf4x16(glm::vec4(vertex.position, 1.0f));
+            memcpy(record, &packed, sizeof(packed));
+            break;
+        }
+        case POSITION_SHORT:
+        {
+            glm::vec3 stored = glm::round((vertex.position - center) / scale);
+            GLshort values[4] = { (GLshort)stored.x, (GLshort)stored.y, (GLshort)stored.z, 1 };
+            memcpy(record, values, sizeof(values));
+            break;
+        }
+        }
+        record += positionSize(format.position);
+
+        if (format.color == COLOR_FLOAT)
+        {
+            memcpy(record, &vertex.color, 3 * sizeof(float));
+        }
+        else if (format.color == COLOR_UNORM8)
+        {
+            // byte order in memory is r, g, b, a as the attribute reads it
+            glm::uint32 packed = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+            memcpy(record, &packed, sizeof(packed));
+        }
+        record += colorSize(format.color);
+
+        if (format.normal == NORMAL_FLOAT)
+        {
+            memcpy(record, &vertex.normal, 3 * sizeof(float));
+        }
+        else if (format.normal == NORMAL_INT_2_10_10_10)
+        {
+            // x in the low bits, as GL_INT_2_10_10_10_REV expects
+            glm::uint32 packed = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+            memcpy(record, &packed, sizeof(packed));
+        }
+    }
+}
+
+void setVertexAttributes(const VertexFormat& format)
+{
+    GLsizei stride = (GLsizei)format.stride();
+    size_t offset = 0;
+
+    switch (format.position)
+    {
+    case POSITION_FLOAT:
+        glVertexAttribPointer(VERTEX_POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        break;
+    case POSITION_HALF:
+        glVertexAttribPointer(VERTEX_POSITION_LOCATION, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offset);
+        break;
+    case POSITION_SHORT:
+        glVertexAttribPointer(VERTEX_POSITION_LOCATION, 3, GL_SHORT, GL_FALSE, stride, (void*)offset);
+        break;
+    }
+    glEnableVertexAttribArray(VERTEX_POSITION_LOCATION);
+    offset += positionSize(format.position);
+
+    if (format.color == COLOR_FLOAT)
+        glVertexAttribPointer(VERTEX_COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+    else if (format.color == COLOR_UNORM8)
+        glVertexAttribPointer(VERTEX_COLOR_LOCATION, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offset);
+    if (format.color != COLOR_NONE)
+        glEnableVertexAttribArray(VERTEX_COLOR_LOCATION);
+    offset += colorSize(format.color);
+
+    if (format.normal == NORMAL_FLOAT)
+        glVertexAttribPointer(VERTEX_NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+    else if (format.normal == NORMAL_INT_2_10_10_10)
+        glVertexAttribPointer(VERTEX_NORMAL_LOCATION, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offset);
+    if (format.normal != NORMAL_NONE)
+        glEnableVertexAttribArray(VERTEX_NORMAL_LOCATION);
+}
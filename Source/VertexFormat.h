@@ -0,0 +1,76 @@
+//
+// COMP 371 Labs Framework
+//
+// Vertex layouts of the meshes, from plain floats to packed attributes:
+// half-float or 16-bit integer positions, RGBA8 colors and 2_10_10_10
+// normals. Meshes are described with MeshVertex and encoded when they are
+// uploaded; integer positions are scaled to the mesh bounds and come with a
+// dequantization matrix that maps them back to model space.
+//
+
+#pragma once
+
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Vertex attribute locations, 2 to 6 are used by the instance data
+const GLuint VERTEX_POSITION_LOCATION = 0;
+const GLuint VERTEX_COLOR_LOCATION = 1;
+const GLuint VERTEX_NORMAL_LOCATION = 7;
+
+// Mesh vertex before encoding
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec3 color;
+    glm::vec3 normal;       // unit length, or zero when the mesh has none
+};
+
+enum PositionEncoding
+{
+    POSITION_FLOAT,     // 3 x GL_FLOAT, 12 bytes
+    POSITION_HALF,      // 4 x GL_HALF_FLOAT, 8 bytes, exact for small integers and halves
+    POSITION_SHORT      // 4 x GL_SHORT in the mesh bounds, 8 bytes, needs the dequantization matrix
+};
+
+enum ColorEncoding
+{
+    COLOR_NONE,
+    COLOR_FLOAT,        // 3 x GL_FLOAT, 12 bytes
+    COLOR_UNORM8        // 4 x normalized GL_UNSIGNED_BYTE, 4 bytes
+};
+
+enum NormalEncoding
+{
+    NORMAL_NONE,
+    NORMAL_FLOAT,       // 3 x GL_FLOAT, 12 bytes
+    NORMAL_INT_2_10_10_10   // normalized GL_INT_2_10_10_10_REV, 4 bytes
+};
+
+struct VertexFormat
+{
+    PositionEncoding position;
+    ColorEncoding color;
+    NormalEncoding normal;
+
+    // Every attribute as floats, the layout meshes used to have
+    static VertexFormat full(bool hasNormals);
+    // Smallest encodings, GL_SHORT positions when dequantizing is possible
+    static VertexFormat packed(bool hasNormals);
+
+    // Bytes per vertex, every attribute starts 4-byte aligned
+    size_t stride() const;
+};
+
+// Interleaves the encoded vertices into out. dequantization maps the stored
+// positions back to the input ones, identity unless positions are GL_SHORT.
+void encodeVertices(const VertexFormat& format, const MeshVertex* vertices, size_t count,
+    std::vector<unsigned char>& out, glm::mat4& dequantization);
+
+// glVertexAttribPointer for every attribute of the format, from the bound
+// GL_ARRAY_BUFFER into the bound vertex array
+void setVertexAttributes(const VertexFormat& format);
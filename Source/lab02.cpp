@@ -22,232 +22,459 @@
 #include <string>
 #include <sstream>
 
-const char* getVertexShaderSource()
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "CameraUniforms.h"
+#include "DrawCommandBuffer.h"
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "FrameStats.h"
+#include "Framebuffer.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+#include "Grid.h"
+#include "Input.h"
+#include "IndirectRenderer.h"
+#include "InstancedRenderer.h"
+#include "JobBenchmark.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "OffscreenContext.h"
+#include "Profiler.h"
+#include "ResourcePath.h"
+#include "ScalingBenchmark.h"
+#include "Scene.h"
+#include "ShaderProgram.h"
+#include "ShaderWatcher.h"
+#include "StreamBuffer.h"
+#include "TransformBenchmark.h"
+#include "TransformHierarchy.h"
+#include "TripleBuffer.h"
+
+// How the cubes of a frame are submitted, F1 cycles through the supported ones
+enum RenderPath
 {
-    return
-        "#version 330 core\n"
-        "layout (location = 0) in vec3 aPos;"
-        ""
-        ""
-        "uniform vec3 aColor = vec3(1.0f, 1.0f, 1.0f);"
-        "uniform mat4 worldMatrix;"
-        "uniform mat4 viewMatrix = mat4(1.0);"
-        "uniform mat4 projectionMatrix = mat4(1.0);"
-        ""
-        "out vec3 vertexColor;"
-        "void main()"
-        "{"
-        "   vertexColor = aColor;"
-        "   mat4 modelViewProjection = projectionMatrix * viewMatrix * worldMatrix;"
-        "   gl_Position = modelViewProjection * vec4(aPos.x, aPos.y, aPos.z, 1.0);"
-        "}";
-}
+    RENDER_DIRECT,      // one glDrawElements per cube
+    RENDER_INSTANCED,   // one glDrawElementsInstanced per frame
+    RENDER_INDIRECT,    // one glMultiDrawElementsIndirect per frame, a draw record per model
+    RENDER_PATH_COUNT
+};
 
+const char* const renderPathNames[RENDER_PATH_COUNT] = { "direct", "instanced", "indirect" };
 
-const char* getFragmentShaderSource()
+// Transformations applied to a whole model with the keyboard
+struct ModelState
 {
-    return
-        "#version 330 core\n"
-        "in vec3 vertexColor;"
-        "out vec4 FragColor;"
-        "void main()"
-        "{"
-        "   FragColor = vec4(vertexColor.r, vertexColor.g, vertexColor.b, 1.0f);"
-        "}";
-}
-
+    float anglex = 0;   // rotation around the y-axis, in degrees
+    float angley = 0;   // rotation around the x-axis, in degrees
+    float movex = 0;
+    float movey = 0;
+    float scale = 1;
+};
+
+// Everything the fixed-step simulation advances. Two consecutive ticks are
+// kept so that frames drawn between them can be interpolated.
+struct SimulationState
+{
+    std::vector<ModelState> models;     // indexed like the scene models
+    float worldAnglex = 0;              // degrees
+    float worldAngley = 0;
+    glm::vec3 cameraPosition;
+};
 
-int compileAndLinkShaders()
+// out = previous + (current - previous) * alpha, alpha in [0, 1]
+void interpolateState(const SimulationState& previous, const SimulationState& current, float alpha, SimulationState& out)
 {
-    // compile and link shader program
-    // return shader program id
-    // ------------------------------------
-
-    // vertex shader
-    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    const char* vertexShaderSource = getVertexShaderSource();
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    out.models.resize(current.models.size());
+    for (size_t i = 0; i < current.models.size(); ++i)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        const ModelState& a = previous.models[i];
+        const ModelState& b = current.models[i];
+        out.models[i].anglex = glm::mix(a.anglex, b.anglex, alpha);
+        out.models[i].angley = glm::mix(a.angley, b.angley, alpha);
+        out.models[i].movex = glm::mix(a.movex, b.movex, alpha);
+        out.models[i].movey = glm::mix(a.movey, b.movey, alpha);
+        out.models[i].scale = glm::mix(a.scale, b.scale, alpha);
     }
+    out.worldAnglex = glm::mix(previous.worldAnglex, current.worldAnglex, alpha);
+    out.worldAngley = glm::mix(previous.worldAngley, current.worldAngley, alpha);
+    out.cameraPosition = glm::mix(previous.cameraPosition, current.cameraPosition, alpha);
+}
 
-    // fragment shader
-    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    const char* fragmentShaderSource = getFragmentShaderSource();
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+// Ids of the sort key fields, see makeDrawKey. Everything is opaque and
+// drawn with the same program for now; the grid sorts before the cubes.
+enum DrawPass { PASS_OPAQUE };
+enum DrawProgram { PROGRAM_COLOR };
+enum DrawMesh { MESH_GRID, MESH_CUBE };
 
-    // check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+// A grid or cube to draw. The world matrix of a cube also brings its
+// quantized positions back to unit size.
+struct DrawRecord
+{
+    glm::mat4 worldMatrix;
+    glm::vec3 color;
+    DrawMesh mesh;
+};
 
-    // link shaders
-    int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+// A finished frame to save to a file
+struct CaptureRequest
+{
+    std::string path;
+    CaptureFormat format;
+    bool screenshot;    // reported on the console, sequence frames are not
+};
+
+// Everything the render thread needs to draw a frame, built by the main thread
+// after the simulation, transforms and culling. Packets are recycled by the
+// TripleBuffer, so every field is rewritten each frame. The transient arrays
+// come from the packet's arena, reset when the main thread takes the packet
+// back: the render thread is done with it by then, and the arena has grown to
+// the size of a frame, so a steady frame does not allocate.
+struct FramePacket
+{
+    FrameArena arena;
+    bool quit = false;          // the render thread stops instead of drawing
+    float frameTime = 0.0f;     // seconds since the previous packet
+    float time = 0.0f;          // seconds since startup
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::vec3 cameraPosition;
+    RenderPath renderPath = RENDER_DIRECT;
+    GLenum drawMode = GL_TRIANGLES;
+    DrawRecord* draws = NULL;       // from the arena
+    unsigned int drawCount = 0;
+    DrawCommandBuffer commands;     // the draws in submission order, from the arena
+    std::vector<CaptureRequest> captures;
+    int captureWidth = 0;       // of the framebuffer the captures read, the window's may not be 1024x768
+    int captureHeight = 0;
+    // counters of the main thread, added to the render thread's frameStats
+    int matricesRecomputed = 0;
+    int objectsTested = 0;
+    int objectsCulled = 0;
+    int allocations = 0;
+    bool showFrameStats = false;
+    bool writeProfile = false;
+};
+
+// Yields for a few rounds, then sleeps in short steps, until condition() holds.
+// The two threads of the frame loop wait for each other with it.
+template <typename Condition>
+void waitUntil(Condition condition)
+{
+    for (int rounds = 0; !condition(); ++rounds)
+    {
+        if (rounds < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    return shaderProgram;
+// Seconds since the first call. Used instead of glfwGetTime so that the
+// timings also work with --headless, where GLFW is never initialized.
+double elapsedSeconds()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 #pragma region VAOs
 
 // laila's colors!
-int createVertexArrayObject2()
+bool createCubeMesh(Mesh& cube, MeshOptimizationStats& stats)
 {
     // A vertex is a point on a polygon, it contains positions and other data (eg: colors)
-    glm::vec3 vertexArray[] = {  // position,                            color
-        glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.3f, 0.0f, 0.6f), //left - red
-        glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(0.3f, 0.0f, 0.6f),
-        glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.3f, 0.0f, 0.6f),
-
-        glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.3f, 0.0f, 0.6f),
-        glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.3f, 0.0f, 0.6f),
-        glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(0.3f, 0.0f, 0.6f),
-
-        glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(0.0f, 0.0f,  0.5f), // far - blue
-        glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.0f, 0.0f, 0.5f),
-        glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(0.0f, 0.0f, 0.5f),
-
-        glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(0.0f, 0.0f,  0.5f),
-        glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(0.0f, 0.0f,  0.5f),
-        glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.0f, 0.0f, 0.5f),
-
-        glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(0.7f,  0.0f, 1.0f), // bottom - turquoise
-        glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.7f, 0.0f, 1.0f),
-        glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(0.7f,  0.0f, 1.0f),
-
-        glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(0.7f,  0.0f, 1.0f),
-        glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(0.7f, 0.0f, 1.0f),
-        glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.7f, 0.0f, 1.0f),
-
-        glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), // near - pink
-        glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f),
-        glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f),
-
-        glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f),
-        glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f),
-        glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f),
-
-        glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 1.0f), // right - purple
-        glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 1.0f),
-        glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 1.0f),
-
-        glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 1.0f),
-        glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 1.0f),
-        glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 1.0f),
-
-        glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 0.0f), // top - yellow
-        glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 1.0f, 0.0f),
-        glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 1.0f, 0.0f),
-
-        glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 0.0f),
-        glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 1.0f, 0.0f),
-        glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 0.0f)
+    MeshVertex vertexArray[] = {  // position,                           color,                      normal
+        { glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.3f, 0.0f, 0.6f), glm::vec3(-1.0f, 0.0f, 0.0f) }, //left - red
+        { glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(0.3f, 0.0f, 0.6f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+        { glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.3f, 0.0f, 0.6f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+
+        { glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.3f, 0.0f, 0.6f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+        { glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.3f, 0.0f, 0.6f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+        { glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(0.3f, 0.0f, 0.6f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+
+        { glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(0.0f, 0.0f,  0.5f), glm::vec3( 0.0f, 0.0f,-1.0f) }, // far - blue
+        { glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3( 0.0f, 0.0f,-1.0f) },
+        { glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3( 0.0f, 0.0f,-1.0f) },
+
+        { glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(0.0f, 0.0f,  0.5f), glm::vec3( 0.0f, 0.0f,-1.0f) },
+        { glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(0.0f, 0.0f,  0.5f), glm::vec3( 0.0f, 0.0f,-1.0f) },
+        { glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3( 0.0f, 0.0f,-1.0f) },
+
+        { glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(0.7f,  0.0f, 1.0f), glm::vec3( 0.0f,-1.0f, 0.0f) }, // bottom - turquoise
+        { glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.7f, 0.0f, 1.0f), glm::vec3( 0.0f,-1.0f, 0.0f) },
+        { glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(0.7f,  0.0f, 1.0f), glm::vec3( 0.0f,-1.0f, 0.0f) },
+
+        { glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(0.7f,  0.0f, 1.0f), glm::vec3( 0.0f,-1.0f, 0.0f) },
+        { glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(0.7f, 0.0f, 1.0f), glm::vec3( 0.0f,-1.0f, 0.0f) },
+        { glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.7f, 0.0f, 1.0f), glm::vec3( 0.0f,-1.0f, 0.0f) },
+
+        { glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), glm::vec3( 0.0f, 0.0f, 1.0f) }, // near - pink
+        { glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), glm::vec3( 0.0f, 0.0f, 1.0f) },
+        { glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), glm::vec3( 0.0f, 0.0f, 1.0f) },
+
+        { glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), glm::vec3( 0.0f, 0.0f, 1.0f) },
+        { glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), glm::vec3( 0.0f, 0.0f, 1.0f) },
+        { glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 0.4f), glm::vec3( 0.0f, 0.0f, 1.0f) },
+
+        { glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3( 1.0f, 0.0f, 0.0f) }, // right - purple
+        { glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3( 1.0f, 0.0f, 0.0f) },
+        { glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3( 1.0f, 0.0f, 0.0f) },
+
+        { glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3( 1.0f, 0.0f, 0.0f) },
+        { glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3( 1.0f, 0.0f, 0.0f) },
+        { glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3( 1.0f, 0.0f, 0.0f) },
+
+        { glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3( 0.0f, 1.0f, 0.0f) }, // top - yellow
+        { glm::vec3(0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3( 0.0f, 1.0f, 0.0f) },
+        { glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3( 0.0f, 1.0f, 0.0f) },
+
+        { glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3( 0.0f, 1.0f, 0.0f) },
+        { glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3( 0.0f, 1.0f, 0.0f) },
+        { glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3( 0.0f, 1.0f, 0.0f) }
     };
 
-    // Create a vertex array
-    GLuint vertexArrayObject2;
-    glGenVertexArrays(1, &vertexArrayObject2);
-    glBindVertexArray(vertexArrayObject2);
-
-
-    // Upload Vertex Buffer to the GPU, keep a reference to it (vertexBufferObject)
-    GLuint vertexBufferObject;
-    glGenBuffers(1, &vertexBufferObject);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexArray), vertexArray, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0,                   // attribute 0 matches aPos in Vertex Shader
-        3,                   // size
-        GL_FLOAT,            // type
-        GL_FALSE,            // normalized?
-        2 * sizeof(glm::vec3), // stride - each vertex contain 2 vec3 (position, color)
-        (void*)0             // array buffer offset
-    );
-    glEnableVertexAttribArray(0);
-
-
-    glVertexAttribPointer(1,                            // attribute 1 matches aColor in Vertex Shader
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        2 * sizeof(glm::vec3),
-        (void*)sizeof(glm::vec3)      // color is offseted a vec3 (comes after position)
-    );
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    return vertexArrayObject2;
+    // 36 vertices become 24 unique vertices and 36 indices, stored in 12 bytes
+    // per vertex instead of 24: GL_SHORT positions and RGBA8 colors.
+    // The shaders do no lighting yet, so the normals are not uploaded.
+    return cube.createFromTriangles(VertexFormat::packed(false), vertexArray, sizeof(vertexArray) / sizeof(vertexArray[0]), &stats);
 }
 #pragma endregion
 
+// --headless runs skip the first frames in their checks and statistics: the
+// arenas, the stream buffer and the driver's shader compiler take what they need
+const int HEADLESS_WARMUP_FRAMES = 8;
+
+// Settings of one run of the lab, from the command line or from --bench-scaling
+struct LabOptions
+{
+    std::string scenePath;
+    int headlessFrames = 0;
+    bool recording = false;
+    RenderPath renderPath = RENDER_DIRECT;
+    unsigned int sceneCopies = 0;   // when > 0, the scene is replicated that many times on a grid
+    bool cameraPath = false;        // the camera circles the scene instead of following the inputs
+    ScalingRun* report = NULL;      // filled with the frame times and counters of a headless run
+};
+
+int runLab(const LabOptions& options);
+
+// --bench-scaling: the scene copied up to 1, 100, 10k and 1M parts, each size
+// drawn headless with every render path, or only the one of --render-path.
+// The JSON report is printed and written to bench-scaling.json.
+int runScalingBenchmark(LabOptions options, bool allRenderPaths)
+{
+    const unsigned int targetParts[] = { 1, 100, 10000, 1000000 };
+
+    Scene scene;
+    if (!scene.load(options.scenePath) || scene.partCount() == 0)
+    {
+        std::cerr << "ERROR::SCALING_BENCHMARK::EMPTY_SCENE " << options.scenePath << std::endl;
+        return 1;
+    }
+    unsigned int partsPerCopy = scene.partCount();
+
+    if (options.headlessFrames == 0)
+        options.headlessFrames = 48;
+    options.headlessFrames = std::max(options.headlessFrames, HEADLESS_WARMUP_FRAMES + 1);
+    options.recording = false;
+    options.cameraPath = true;
+
+    std::vector<ScalingRun> runs;
+    int exitCode = 0;
+    for (size_t size = 0; size < sizeof(targetParts) / sizeof(targetParts[0]); ++size)
+    {
+        for (int path = 0; path < RENDER_PATH_COUNT; ++path)
+        {
+            if (!allRenderPaths && path != options.renderPath)
+                continue;
+
+            ScalingRun run;
+            run.targetParts = targetParts[size];
+            run.copies = (targetParts[size] + partsPerCopy - 1) / partsPerCopy;
+            run.renderPath = renderPathNames[path];
+            std::cout << "Scaling benchmark: " << run.copies * partsPerCopy << " parts, " << run.renderPath << std::endl;
+
+            LabOptions runOptions = options;
+            runOptions.renderPath = (RenderPath)path;
+            runOptions.sceneCopies = run.copies;
+            runOptions.report = &run;
+            run.exitCode = runLab(runOptions);
+            if (run.exitCode != 0)
+                exitCode = 1;
+            runs.push_back(run);
+        }
+    }
+
+    std::ofstream file("bench-scaling.json");
+    writeScalingReport(file, runs, options.headlessFrames, HEADLESS_WARMUP_FRAMES);
+    writeScalingReport(std::cout, runs, options.headlessFrames, HEADLESS_WARMUP_FRAMES);
+    if (!file)
+    {
+        std::cerr << "ERROR::SCALING_BENCHMARK::WRITE_FAILED bench-scaling.json" << std::endl;
+        return 1;
+    }
+    return exitCode;
+}
+
 int main(int argc, char* argv[])
 {
-    // Initialize GLFW and OpenGL version
-    glfwInit();
+    // --scene <file> loads another scene than the CHAMMA word
+    // --bench-transforms runs the transform microbenchmark and exits, no window is created
+    // --bench-jobs runs the job system scaling benchmark and exits, no window is created
+    // --bench-scaling runs the scene scaling benchmark, --headless <frames> sets its frame count
+    // --headless <frames> renders that many frames offscreen and prints their CPU time
+    // --record starts recording a frame sequence, as F11 does
+    // --render-path direct|instanced|indirect starts with another render path than direct
+    LabOptions options;
+    options.scenePath = resolveResourcePath("res/scenes/chamma.scene");
+    bool benchScaling = false;
+    bool renderPathGiven = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--scene" && i + 1 < argc)
+            options.scenePath = argv[++i];
+        else if (std::string(argv[i]) == "--render-path" && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            for (int path = 0; path < RENDER_PATH_COUNT; ++path)
+            {
+                if (name == renderPathNames[path])
+                {
+                    options.renderPath = (RenderPath)path;
+                    renderPathGiven = true;
+                }
+            }
+        }
+        else if (std::string(argv[i]) == "--headless" && i + 1 < argc)
+            options.headlessFrames = std::max(atoi(argv[++i]), 1);
+        else if (std::string(argv[i]) == "--record")
+            options.recording = true;
+        else if (std::string(argv[i]) == "--bench-transforms")
+            return runTransformBenchmark(std::cout);
+        else if (std::string(argv[i]) == "--bench-jobs")
+            return runJobBenchmark(std::cout);
+        else if (std::string(argv[i]) == "--bench-scaling")
+            benchScaling = true;
+    }
 
+    if (benchScaling)
+        return runScalingBenchmark(options, !renderPathGiven);
+    return runLab(options);
+}
+
+int runLab(const LabOptions& options)
+{
+    std::string scenePath = options.scenePath;
+    int headlessFrames = options.headlessFrames;
+    bool recording = options.recording;
+    RenderPath renderPath = options.renderPath;
+
+    // Without a display, GLFW is not used at all: the context comes from EGL
+    // and frames are drawn into a framebuffer object of the window's size
+    bool headless = headlessFrames > 0;
+    OffscreenContext offscreenContext;
+    GLFWwindow* window = NULL;
+    if (headless)
+    {
+        if (!offscreenContext.create())
+        {
+            std::cerr << "Failed to create the offscreen context" << std::endl;
+            return -1;
+        }
+    }
+    else
+    {
+        // Initialize GLFW and OpenGL version
+        glfwInit();
+
+        // Core profile everywhere, nothing is drawn in immediate mode anymore
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #if defined(PLATFORM_OSX)
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-    // On windows, we set OpenGL version to 2.1, to support more hardware
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    glfwWindowHint(GLFW_SAMPLES, 4); // creates more buffers for model smoothing
-    // Create Window and rendering context using GLFW, resolution is 1024x768
-    GLFWwindow* window = glfwCreateWindow(1024, 768, "Comp371 - Lab 02", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        glfwWindowHint(GLFW_SAMPLES, 4); // creates more buffers for model smoothing
+        // Create Window and rendering context using GLFW, resolution is 1024x768
+        window = glfwCreateWindow(1024, 768, "Comp371 - Lab 02", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
     }
-    glfwMakeContextCurrent(window);
 
+    // Keyboard and mouse events are collected by callbacks and mapped to actions
+    Input input;
+    if (window != NULL)
+        input.attach(window);
 
     // Initialize GLEW
     glewExperimental = true; // Needed for core profile
-    if (glewInit() != GLEW_OK) {
+    GLenum glewStatus = glewInit();
+    // a GLX build of GLEW has no X display to query under EGL, the GL functions are loaded anyway
+    if (glewStatus != GLEW_OK && !(headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)) {
         std::cerr << "Failed to create GLEW" << std::endl;
         glfwTerminate();
         return -1;
     }
+    // the cache may still hold the bindings of the context of an earlier run, with --bench-scaling
+    GLStateCache::invalidate();
+
+    // Offscreen render target, same size and sample count as the window
+    Framebuffer offscreenFramebuffer;
+    if (headless)
+    {
+        if (!offscreenFramebuffer.create(1024, 768, 4))
+        {
+            std::cerr << "Failed to create the offscreen framebuffer" << std::endl;
+            return -1;
+        }
+        offscreenFramebuffer.bind();
+    }
 
     // Black background
     glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
 
     // Compile and link shaders here ...
-    int shaderProgram = compileAndLinkShaders();
-    glUseProgram(shaderProgram);
+    // Shaders are read from res/shaders, linked programs are cached next to them
+    double shaderLoadStart = elapsedSeconds();
+    std::string vertexShaderPath = resolveResourcePath("res/shaders/VertexShader.glsl");
+    std::string instancedVertexShaderPath = resolveResourcePath("res/shaders/InstancedVertexShader.glsl");
+    std::string indirectVertexShaderPath = resolveResourcePath("res/shaders/IndirectVertexShader.glsl");
+    std::string fragmentShaderPath = resolveResourcePath("res/shaders/FragmentShader.glsl");
+    ShaderProgram shaderProgram;
+    if (!shaderProgram.createFromFiles(vertexShaderPath, fragmentShaderPath))
+    {
+        std::cerr << "Failed to create the shader program" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    double shaderLoadTime = elapsedSeconds() - shaderLoadStart;
+    shaderProgram.use();
+
+    // view and projection are in the Camera uniform block, uploaded once per
+    // frame for all programs; every program reads it from the same binding
+    CameraUniformBuffer cameraUniforms;
+    cameraUniforms.create();
+    shaderProgram.bindUniformBlock(CAMERA_UNIFORM_BLOCK, CAMERA_UNIFORM_BINDING);
+
+    // uniforms are resolved once, the setters skip values that are already uploaded
+    int worldMatrixUniform = shaderProgram.uniformIndex("worldMatrix");
+    int colorUniform = shaderProgram.uniformIndex("aColor");
+
     //feild of vew variable
     float feild_of_vew = 70.0f;
     float temp_feild_of_vew = 70.0f;
@@ -256,93 +483,231 @@ int main(int argc, char* argv[])
         1024.0f / 768.0f,  // aspect ratio
         0.01f, 100.0f);   // near and far (near > 0)
 
-    GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
     //params
     // Camera parameters for view transform
-    glm::vec3 cameraPosition = glm::vec3(0.6f, 1.0f, 10.0f);
+    SimulationState state;
+    state.cameraPosition = glm::vec3(0.6f, 1.0f, 10.0f);
     glm::vec3 cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
     glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
     // Set initial view matrix
-    glm::mat4 viewMatrix = glm::lookAt(cameraPosition,  // eye
-        cameraPosition + cameraLookAt,  // center
+    glm::mat4 viewMatrix = glm::lookAt(state.cameraPosition,  // eye
+        state.cameraPosition + cameraLookAt,  // center
         cameraUp); // up
 
-    GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
-
     // Define and upload geometry to the GPU here ...
-    int vao2 = createVertexArrayObject2();
+    Mesh cube;
+    MeshOptimizationStats cubeStats;
+    createCubeMesh(cube, cubeStats);
+    std::cout << "Cube mesh: " << cubeStats.inputVertices << " vertices (ACMR 3 unindexed) -> "
+        << cubeStats.vertices << " vertices, " << cubeStats.indices << " indices, ACMR "
+        << cubeStats.weldedAcmr << " welded, " << cubeStats.optimizedAcmr << " reordered" << std::endl;
+    std::cout << "Cube vertex buffer: " << cubeStats.vertexBytes << " bytes packed, "
+        << cubeStats.fullVertexBytes - cubeStats.vertexBytes << " saved over floats" << std::endl;
+
+    // Ground grid, one line every gridSpacing units up to gridHalfExtent from the origin
+    float gridHalfExtent = 50.0f;
+    float gridSpacing = 1.0f;
+    Grid grid;
+    grid.create(gridHalfExtent, gridSpacing, -0.1f);
+
+    // Models and their parts, compiled to a binary next to the scene file on first load
+    double sceneLoadStart = elapsedSeconds();
+    Scene scene;
+    if (!scene.load(scenePath))
+    {
+        std::cerr << "Failed to load scene " << scenePath << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    if (options.sceneCopies > 0)
+        scene.replicate(options.sceneCopies, glm::vec2(16.0f, 4.0f));
+    std::cout << "Loaded " << scenePath << ": " << scene.modelCount() << " models, " << scene.partCount() << " parts in "
+        << 1000.0 * (elapsedSeconds() - sceneLoadStart) << " ms" << std::endl;
+
+    // --bench-scaling: the camera circles the middle of the models, the same path for every size
+    glm::vec3 cameraPathCenter(0.0f);
+    if (options.cameraPath && scene.modelCount() > 0)
+    {
+        glm::vec3 lower(FLT_MAX), upper(-FLT_MAX);
+        for (unsigned int i = 0; i < scene.modelCount(); ++i)
+        {
+            lower = glm::min(lower, scene.model(i).position);
+            upper = glm::max(upper, scene.model(i).position);
+        }
+        cameraPathCenter = 0.5f * (lower + upper);
+    }
+
+    // Per-frame data written by the CPU and drawn right away, 1 MB per frame in flight
+    StreamBuffer streamBuffer;
+    bool streamingSupported = streamBuffer.create(GL_ARRAY_BUFFER, 1 << 20, 3);
+    if (streamingSupported)
+        std::cout << "Streaming buffer: 3 x 1 MB, " << (streamBuffer.isPersistent() ? "persistently mapped" : "orphaned on wrap") << std::endl;
+
+    // Instanced path: every cube of a frame goes in one glDrawElementsInstanced call
+    bool instancingSupported = InstancedRenderer::isSupported();
+    ShaderProgram instancedShaderProgram;
+    InstancedRenderer instancedRenderer;
+    if (instancingSupported)
+    {
+        shaderLoadStart = elapsedSeconds();
+        instancingSupported = instancedShaderProgram.createFromFiles(instancedVertexShaderPath, fragmentShaderPath);
+        shaderLoadTime += elapsedSeconds() - shaderLoadStart;
+        if (instancingSupported)
+        {
+            instancedShaderProgram.bindUniformBlock(CAMERA_UNIFORM_BLOCK, CAMERA_UNIFORM_BINDING);
+            instancedRenderer.initialize(cube.vertexArray(), &streamBuffer);
+            instancedRenderer.reserve(scene.partCount());
+        }
+        shaderProgram.use();
+    }
+
+    // Indirect path, GL 4.3: objects in a storage buffer, one multi-draw for all the draw records
+    bool indirectSupported = IndirectRenderer::isSupported() && streamingSupported;
+    ShaderProgram indirectShaderProgram;
+    IndirectRenderer indirectRenderer;
+    if (indirectSupported)
+    {
+        shaderLoadStart = elapsedSeconds();
+        indirectSupported = indirectShaderProgram.createFromFiles(indirectVertexShaderPath, fragmentShaderPath);
+        shaderLoadTime += elapsedSeconds() - shaderLoadStart;
+        if (indirectSupported)
+        {
+            indirectShaderProgram.bindUniformBlock(CAMERA_UNIFORM_BLOCK, CAMERA_UNIFORM_BINDING);
+            indirectRenderer.initialize(cube.vertexArray(), streamBuffer);
+            indirectRenderer.reserve(scene.partCount());
+        }
+        shaderProgram.use();
+    }
+    std::cout << "Shaders ready in " << 1000.0 * shaderLoadTime << " ms"
+        << (shaderProgram.loadedFromCache() ? " (program binary cache)" : " (compiled)") << std::endl;
+    if (!instancingSupported)
+    {
+        std::cerr << "Instanced rendering is not supported by this context, F1 skips the instanced render path" << std::endl;
+    }
+    if (!indirectSupported)
+    {
+        std::cerr << "Multi-draw indirect needs OpenGL 4.3, F1 skips the indirect render path" << std::endl;
+    }
+    bool renderPathSupported[RENDER_PATH_COUNT] = { true, instancingSupported, indirectSupported };
+    if (!renderPathSupported[renderPath])
+        renderPath = RENDER_DIRECT;
+    // Shader hot-reload: a watcher thread flags edits of res/shaders/*.glsl and the
+    // programs are rebuilt between two frames. A program that fails to build is
+    // reported like at startup and the previous one stays in use.
+    ShaderWatcher shaderWatcher;
+    if (!headless)
+        shaderWatcher.start(vertexShaderPath.substr(0, vertexShaderPath.find_last_of("/\\")));
+    auto reloadShaders = [&]()
+    {
+        // a new link rebuilds the uniform table, indices have to be resolved again
+        if (shaderProgram.createFromFiles(vertexShaderPath, fragmentShaderPath))
+        {
+            shaderProgram.bindUniformBlock(CAMERA_UNIFORM_BLOCK, CAMERA_UNIFORM_BINDING);
+            worldMatrixUniform = shaderProgram.uniformIndex("worldMatrix");
+            colorUniform = shaderProgram.uniformIndex("aColor");
+            std::cout << "Reloaded " << vertexShaderPath << std::endl;
+        }
+        else
+        {
+            std::cerr << "Keeping the previous shader program" << std::endl;
+        }
+
+        if (instancingSupported)
+        {
+            if (instancedShaderProgram.createFromFiles(instancedVertexShaderPath, fragmentShaderPath))
+            {
+                instancedShaderProgram.bindUniformBlock(CAMERA_UNIFORM_BLOCK, CAMERA_UNIFORM_BINDING);
+                std::cout << "Reloaded " << instancedVertexShaderPath << std::endl;
+            }
+            else
+            {
+                std::cerr << "Keeping the previous instanced shader program" << std::endl;
+            }
+        }
+
+        if (indirectSupported)
+        {
+            if (indirectShaderProgram.createFromFiles(indirectVertexShaderPath, fragmentShaderPath))
+            {
+                indirectShaderProgram.bindUniformBlock(CAMERA_UNIFORM_BLOCK, CAMERA_UNIFORM_BINDING);
+                std::cout << "Reloaded " << indirectVertexShaderPath << std::endl;
+            }
+            else
+            {
+                std::cerr << "Keeping the previous indirect shader program" << std::endl;
+            }
+        }
+        shaderProgram.use();
+    };
 
     float rotationSpeed = 180.0f;  // 180 degrees per second
-    float lastFrameTime = glfwGetTime();
+
+    // Motion is simulated in fixed steps, frames interpolate between the last two steps
+    const float simulationStep = 1.0f / 120.0f;
+    const float maxFrameTime = 0.25f;  // skip time rather than run hundreds of steps after a stall
+    float simulationTime = 0.0f;     // not simulated yet
+    float lastFrameTime = elapsedSeconds();
 
 #pragma region Variables of models
-    bool isPressedA = false;
-    bool isPressedD = false;
-    bool isPressedU = false;
-    bool isPressedJ = false;
     float rotationAngle = 10.0f;
 
-    bool CModelIsOn = false;
-    float CAnglex = 0;
-    float CAngley = 0;
-    float CMovex = 0;
-    float CMovey = 0;
-    float CScale = 1;
-
-    bool HModelIsOn = false;
-    float HAnglex = 0;
-    float HAngley = 0;
-    float HMovex = 0;
-    float HMovey = 0;
-    float HScale = 1;
-
-    bool  A1ModelIsOn = false;
-    float A1Anglex = 0;
-    float A1Angley = 0;
-    float A1Movex = 0;
-    float A1Movey = 0;
-    float A1Scale = 1;
-
-    bool  M1ModelIsOn = false;
-    float M1Anglex = 0;
-    float M1Angley = 0;
-    float M1Movex = 0;
-    float M1Movey = 0;
-    float M1Scale = 1;
-
-    bool  M2ModelIsOn = false;
-    float M2Anglex = 0;
-    float M2Angley = 0;
-    float M2Movex = 0;
-    float M2Movey = 0;
-    float M2Scale = 1;
-
-    bool  A2ModelIsOn = false;
-    float A2Anglex = 0;
-    float A2Angley = 0;
-    float A2Movex = 0;
-    float A2Movey = 0;
-    float A2Scale = 1;
-
-    //for rotating the world
-    float worldAnglex = 0;
-    float worldAngley = 0;
+    // per-model state changed by the keyboard
+    state.models.resize(scene.modelCount());
+    //index of the selected model, -1 when none is selected
+    int selectedModel = -1;
 
     float modelMovementSpeed = 10.0f;
 
+    // world -> model -> part transforms, cached between frames
+    TransformHierarchy transforms;
+    int worldNode = transforms.addNode(-1, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+    std::vector<int> modelNodes(scene.modelCount());
+    std::vector<int> partNodes(scene.partCount());
+    for (unsigned int i = 0; i < scene.modelCount(); ++i)
+    {
+        const SceneModel& model = scene.model(i);
+        // models rotate around y (anglex) then x (angley)
+        modelNodes[i] = transforms.addNode(worldNode, model.position, glm::vec3(0.0f), glm::vec3(1.0f), ROTATE_YXZ);
+        for (unsigned int j = model.firstPart; j < model.firstPart + model.partCount; ++j)
+        {
+            const ScenePart& part = scene.part(j);
+            partNodes[j] = transforms.addNode(modelNodes[i], part.translate, part.rotate, part.scale);
+        }
+    }
+
+    // Workers for the update stages of big scenes: the main thread and one
+    // per remaining hardware thread, the render thread keeps its own core
+    JobSystem jobs(std::max(2u, std::thread::hardware_concurrency()) - 1);
+
+    // world space boxes of the models and of their parts, refreshed when the transforms change
+    BoundingBoxSet modelBounds, partBounds;
+    modelBounds.resize(scene.modelCount());
+    partBounds.resize(scene.partCount());
+    std::vector<unsigned char> modelVisible(scene.modelCount(), 1);
+    std::vector<unsigned char> partVisible(scene.partCount(), 1);
+
+    // material of every part for the sort keys, parts of the same color share one
+    std::vector<unsigned int> partMaterials(scene.partCount());
+    std::vector<glm::vec3> materialColors;
+    for (unsigned int j = 0; j < scene.partCount(); ++j)
+    {
+        const glm::vec3& color = scene.part(j).color;
+        size_t material = std::find(materialColors.begin(), materialColors.end(), color) - materialColors.begin();
+        if (material == materialColors.size())
+            materialColors.push_back(color);
+        partMaterials[j] = (unsigned int)material;
+    }
+
 #pragma endregion
 
     // backface culling
     // Enable Backface culling
-    glEnable(GL_CULL_FACE);
+    GLStateCache::enable(GL_CULL_FACE);
     // Enable Depth test for proper rendering
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_DEPTH_TEST);
     // Enable Multisample to smoothen edges on models and grid lines
-    glEnable(GL_MULTISAMPLE);
+    GLStateCache::enable(GL_MULTISAMPLE);
 
     float cameraSpeed = 20.0f;
     float cameraFastSpeed = 2 * cameraSpeed;
@@ -358,787 +723,662 @@ int main(int argc, char* argv[])
     float tempcamy = 0;
 
     //mouse position
-    double tempxpos, tempypos;
-    GLuint aColorLocation = glGetUniformLocation(shaderProgram, "aColor");
-
-    // Entering Main Loop
-    while (!glfwWindowShouldClose(window))
+    double tempxpos = input.cursorX(), tempypos = input.cursorY();
+
+    //render path (--render-path), F1 cycles through one draw call per cube, one instanced
+    //draw per frame and one multi-draw indirect per frame
+    //F2 prints the frame stats once per second
+    bool showFrameStats = false;
+    //F4 switches frustum culling off, to compare
+    bool useCulling = true;
+    // transforms changed since the bounding boxes were refreshed, also while culling is off
+    bool boundsDirty = true;
+    //F3 writes the profile, on the render thread where the zones are collected
+    bool profileRequested = false;
+
+    // One fixed step of everything that moves while a key is held
+    auto simulate = [&](float step)
     {
-        // Each frame, reset color of each pixel to glClearColor
-        glClear(GL_COLOR_BUFFER_BIT);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Draw grid
-        glUniform3f(aColorLocation, 0.0f, 0.0f, 0.0f);
-        for (int i = 0; i < 200; i++) {
-
-            glBegin(GL_LINES);
-            if (i < 100) { glVertex3f(-50, -0.1, 50 - i); glVertex3f(50, -0.1, 50 - i); }
-            else { glVertex3f(150 - i, -0.1, -50); glVertex3f(150 - i, -0.1, 50); }
-
-            glEnd();
-            //glPopMatrix();
-
+        ModelState* selected = (selectedModel >= 0) ? &state.models[selectedModel] : NULL;
+        if (selected)
+        {
+            //rotate along the Y-axis continuously
+            if (input.isDown(ACTION_MODEL_SPIN_LEFT))
+                selected->anglex += rotationSpeed * step;
+            if (input.isDown(ACTION_MODEL_SPIN_RIGHT))
+                selected->anglex -= rotationSpeed * step;
+
+            //rotate along the X-axis continuously
+            if (input.isDown(ACTION_MODEL_TILT_UP))
+                selected->angley += rotationSpeed * step;
+            if (input.isDown(ACTION_MODEL_TILT_DOWN))
+                selected->angley -= rotationSpeed * step;
+
+            //move with shift + a,d,w,s
+            if (input.isDown(ACTION_MODEL_MOVE_LEFT))
+                selected->movex -= modelMovementSpeed * step;
+            if (input.isDown(ACTION_MODEL_MOVE_RIGHT))
+                selected->movex += modelMovementSpeed * step;
+            if (input.isDown(ACTION_MODEL_MOVE_UP))
+                selected->movey += modelMovementSpeed * step;
+            if (input.isDown(ACTION_MODEL_MOVE_DOWN))
+                selected->movey -= modelMovementSpeed * step;
         }
 
-        float dt = glfwGetTime() - lastFrameTime;
-        lastFrameTime += dt;
-
-#pragma region World
-        glm::mat4 worldContructionMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
-        glm::mat4 worldRotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(worldAnglex), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(worldAngley), glm::vec3(0.0f, 1.0f, 0.0f));
-        worldContructionMatrix = worldContructionMatrix * worldRotationMatrix;
-        GLuint worldMatrixLocation = glGetUniformLocation(shaderProgram, "worldMatrix");
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &worldContructionMatrix[0][0]);
-#pragma endregion
-
-        //reset transformation
-        //this will make the grid move independantly from the models
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f))[0][0]);
-
-#pragma region C
-        glBindVertexArray(vao2);
-        glUniform3f(aColorLocation, 0.9f, 0.5f, 0.7f); //color of C
-        glm::mat4 CRotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(CAnglex), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(CAngley), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 CGroupMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-5.0f + CMovex, 0.2f + CMovey, -20.0f)) * CRotationMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(CScale, CScale, CScale));
-        // C H A M M A
-        // start of C
-        glm::mat4 CPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.5f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        CPartMatrix = worldRotationMatrix * CGroupMatrix * CPartMatrix;
-        worldMatrixLocation = glGetUniformLocation(shaderProgram, "worldMatrix");
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &CPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        CPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        CPartMatrix = worldRotationMatrix * CGroupMatrix * CPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &CPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        CPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.75f, 0.75f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        CPartMatrix = worldRotationMatrix * CGroupMatrix * CPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &CPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-        // end of C
-#pragma endregion
-#pragma region H
-        glUniform3f(aColorLocation, 0.2f, 0.0f, 0.1f); // H color
-
-        // start of H
-        glm::mat4 HRotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(HAnglex), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(HAngley), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 HGroupMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-3.0f + HMovex, 0.2f + HMovey, -20.0f)) * HRotationMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(HScale, HScale, HScale));
-
-        glm::mat4 HPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.75f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        HPartMatrix = worldRotationMatrix * HGroupMatrix * HPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &HPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        HPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.75f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        HPartMatrix = worldRotationMatrix * HGroupMatrix * HPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &HPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-        HPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.15f, 0.75f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        HPartMatrix = worldRotationMatrix * HGroupMatrix * HPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &HPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-        HPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.4f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        HPartMatrix = worldRotationMatrix * HGroupMatrix * HPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &HPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        HPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.4f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        HPartMatrix = worldRotationMatrix * HGroupMatrix * HPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &HPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        // end of H
-#pragma endregion
-#pragma region A1
-        glUniform3f(aColorLocation, 0.1f, 0.0f, 0.4f); // A1 color
-        // start of A
-        glm::mat4 ARotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(A1Anglex), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(A1Angley), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 AGroupMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.9f + A1Movex, 0.2f + A1Movey, -20.0f)) * ARotationMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(A1Scale, A1Scale, A1Scale));
-
-        glm::mat4 APartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.51f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        APartMatrix = worldRotationMatrix * AGroupMatrix * APartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &APartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        APartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.51f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        APartMatrix = worldRotationMatrix * AGroupMatrix * APartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &APartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-
-        APartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.75f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        APartMatrix = worldRotationMatrix * AGroupMatrix * APartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &APartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        APartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.76f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        APartMatrix = worldRotationMatrix * AGroupMatrix * APartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &APartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-        APartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.51f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        APartMatrix = worldRotationMatrix * AGroupMatrix * APartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &APartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        APartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.51f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        APartMatrix = worldRotationMatrix * AGroupMatrix * APartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &APartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        // end of A
-#pragma endregion
-#pragma region M1
-        glUniform3f(aColorLocation, 0.7f, 0.5f, 0.8f); // M1 color
-        // start of M
-        glm::mat4 MRotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(M1Anglex), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(M1Angley), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 MGroupMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f + M1Movex, 0.2f + M1Movey, -20.0f)) * MRotationMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(M1Scale, M1Scale, M1Scale));
-
-
-        glm::mat4 MPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        MPartMatrix = worldRotationMatrix * MGroupMatrix * MPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &MPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        MPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        MPartMatrix = worldRotationMatrix * MGroupMatrix * MPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &MPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-        MPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(-40.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        MPartMatrix = worldRotationMatrix * MGroupMatrix * MPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &MPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        MPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(40.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        MPartMatrix = worldRotationMatrix * MGroupMatrix * MPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &MPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-        MPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        MPartMatrix = worldRotationMatrix * MGroupMatrix * MPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &MPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        MPartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        MPartMatrix = worldRotationMatrix * MGroupMatrix * MPartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &MPartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-        // END OF M
-#pragma endregion
-#pragma region M2
-        glUniform3f(aColorLocation, 0.2f, 0.2f, 0.8f); // M2 color
-         // start of M
-        glm::mat4 M2RotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(M2Anglex), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(M2Angley), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 M2GroupMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(3.56f + M2Movex, 0.2f + M2Movey, -20.0f)) * M2RotationMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(M2Scale, M2Scale, M2Scale));
-
-        glm::mat4 M2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        M2PartMatrix = worldRotationMatrix * M2GroupMatrix * M2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &M2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        M2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        M2PartMatrix = worldRotationMatrix * M2GroupMatrix * M2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &M2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
-
-
-        M2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(-40.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        M2PartMatrix = worldRotationMatrix * M2GroupMatrix * M2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &M2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-        M2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(40.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        M2PartMatrix = worldRotationMatrix * M2GroupMatrix * M2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &M2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-
-
+        // camera movements
+        float currentCameraSpeed = input.isDown(ACTION_CAMERA_FAST) ? cameraFastSpeed : cameraSpeed;
+        if (input.isDown(ACTION_CAMERA_LEFT))
+        {
+            state.cameraPosition.x -= currentCameraSpeed * step * sinf(camx);
+            state.cameraPosition.z -= currentCameraSpeed * step * cosf(camx);
+        }
+        if (input.isDown(ACTION_CAMERA_RIGHT))
+        {
+            state.cameraPosition.x += currentCameraSpeed * step * sinf(camx);
+            state.cameraPosition.z += currentCameraSpeed * step * cosf(camx);
+        }
+        if (input.isDown(ACTION_CAMERA_BACKWARD))
+        {
+            state.cameraPosition.z += currentCameraSpeed * step * sinf(camx);
+            state.cameraPosition.x -= currentCameraSpeed * step * cosf(camx);
+        }
+        if (input.isDown(ACTION_CAMERA_FORWARD))
+        {
+            state.cameraPosition.z -= currentCameraSpeed * step * sinf(camx);
+            state.cameraPosition.x += currentCameraSpeed * step * cosf(camx);
+        }
 
+        //moving camera up ad down with [ , ]
+        if (input.isDown(ACTION_CAMERA_UP))
+            state.cameraPosition.y += currentCameraSpeed * step;
+        if (input.isDown(ACTION_CAMERA_DOWN))
+            state.cameraPosition.y -= currentCameraSpeed * step;
+
+        //Arrow keys for world rotation, angles in degrees
+        if (input.isDown(ACTION_WORLD_ROTATE_LEFT))
+            state.worldAnglex += rotationSpeed * step;
+        if (input.isDown(ACTION_WORLD_ROTATE_RIGHT))
+            state.worldAnglex -= rotationSpeed * step;
+        if (input.isDown(ACTION_WORLD_ROTATE_UP))
+            state.worldAngley += rotationSpeed * step;
+        if (input.isDown(ACTION_WORLD_ROTATE_DOWN))
+            state.worldAngley -= rotationSpeed * step;
+    };
 
-        M2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        M2PartMatrix = worldRotationMatrix * M2GroupMatrix * M2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &M2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+    // state of the previous step, and the interpolated state that is drawn
+    SimulationState previousState = state;
+    SimulationState renderState = state;
 
-        M2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        M2PartMatrix = worldRotationMatrix * M2GroupMatrix * M2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &M2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+    // Screenshots and sequences are read back and encoded in the background,
+    // sequences keep one frame every 1/60 s
+    FrameCapture frameCapture;
+    if (!frameCapture.create(1024, 768, std::max(2u, std::thread::hardware_concurrency() / 2)))
+    {
+        std::cerr << "Failed to create the frame capture, F11 and F12 are disabled" << std::endl;
+        recording = false;
+    }
+    GLuint captureSource = headless ? offscreenFramebuffer.id() : 0;
+    const float recordingInterval = 1.0f / 60.0f;
+    float recordingTime = recordingInterval;    // first frame is captured right away
+    int screenshotCount = 0, recordingCount = 0, recordedFrames = 0;
+    unsigned int droppedBeforeRecording = 0;
+    bool screenshotRequested = false;
+    CaptureFormat screenshotFormat = CAPTURE_PNG;
+    if (recording)
+        std::cout << "Recording sequence" << ++recordingCount << "-*" << captureFileExtension(CAPTURE_PNG) << std::endl;
+
+    // --headless: time between two flushes of the render thread. Update and
+    // submission overlap, so a frame takes as long as the slower of the two.
+    std::vector<double> headlessFrameTimes;
+    headlessFrameTimes.reserve(headlessFrames);
+    if (options.report != NULL)
+        options.report->frameTimes.reserve(headlessFrames);
+    double lastFlushTime = 0.0;
+    int packetCount = 0;
+
+    // Profiling zones of debug builds, F3 writes them as a Chrome trace
+#if PROFILER_ENABLED
+    int profileCount = 0;
+#endif
+    auto writeProfile = [&]()
+    {
+#if PROFILER_ENABLED
+        std::string profilePath = "profile-" + std::to_string(++profileCount) + ".json";
+        if (Profiler::instance().writeChromeTrace(profilePath))
+            std::cout << "Profile written to " << profilePath << std::endl;
+#else
+        std::cout << "Profiling is compiled out of this build, define PROFILER_ENABLED=1 to enable it" << std::endl;
+#endif
+    };
+    PROFILE_GPU_INITIALIZE();
 
-        //END OF M
-#pragma endregion
-#pragma region A2
-        glUniform3f(aColorLocation, 0.8f, 0.4f, 0.8f); // A2 color
-        // start of A
-        glm::mat4 A2RotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(A2Anglex), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(A2Angley), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 A2GroupMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(6.0f + A2Movex, 0.2f + A2Movey, -20.0f)) * A2RotationMatrix * glm::scale(glm::mat4(1.0f), glm::vec3(A2Scale, A2Scale, A2Scale));
+    // frame stats of the render thread, printed once per second with F2
+    FrameStats lastFrameStats = frameStats;
+    float statsTimer = 0.0f;
+    int statsFrameCount = 0;
 
-        glm::mat4 A2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.49f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        A2PartMatrix = worldRotationMatrix * A2GroupMatrix * A2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &A2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+    // set by the render thread when the indirect path ran out of streaming space
+    std::atomic<bool> indirectOverflowed(false);
 
-        A2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-0.49f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        A2PartMatrix = worldRotationMatrix * A2GroupMatrix * A2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &A2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+    // --headless fails when a frame allocates after the warm-up
+    int allocatingFrames = 0;
 
-        A2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.76f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        A2PartMatrix = worldRotationMatrix * A2GroupMatrix * A2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &A2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+    // Draws one packet. Everything that touches GL during the main loop is
+    // here, on the render thread, which also owns frameStats.
+    auto renderFrame = [&](const FramePacket& packet)
+    {
+        PROFILE_FRAME();
+        PROFILE_ZONE("render");
+        uint64_t renderAllocations = threadAllocationCount();
 
-        A2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.75f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        A2PartMatrix = worldRotationMatrix * A2GroupMatrix * A2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &A2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+        // Each frame, reset color of each pixel to glClearColor
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        resetFrameStats();
+        frameStats.matricesRecomputed = packet.matricesRecomputed;
+        frameStats.objectsTested = packet.objectsTested;
+        frameStats.objectsCulled = packet.objectsCulled;
+        frameStats.commandsSorted = (int)packet.commands.size();
+        frameStats.sortMicroseconds = (float)(1e6 * packet.commands.sortSeconds());
+
+        // the stream region of this frame, the GPU is normally done with it already
+        {
+            PROFILE_ZONE("stream wait");
+            streamBuffer.beginFrame();
+        }
 
+        // captures of earlier frames whose pixels arrived go to the encoders
+        bool captureAllocated = frameCapture.update();
 
-        A2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.51f, 1.3f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        A2PartMatrix = worldRotationMatrix * A2GroupMatrix * A2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &A2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+        // frame boundary: swap in the edited shaders, if any
+        if (shaderWatcher.hasChanges())
+        {
+            PROFILE_ZONE("reload shaders");
+            reloadShaders();
+        }
 
-        A2PartMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.51f, 0.2f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f));
-        A2PartMatrix = worldRotationMatrix * A2GroupMatrix * A2PartMatrix;
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &A2PartMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
+        // one upload of the camera matrices for all programs
+        cameraUniforms.update(packet.viewMatrix, packet.projectionMatrix, packet.cameraPosition, packet.time);
 
-        // end of A
+        RenderPath renderPath = packet.renderPath;
+        if (renderPath == RENDER_INSTANCED)
+            instancedRenderer.begin();
+        else if (renderPath == RENDER_INDIRECT)
+            indirectRenderer.begin();
 
+#pragma region Models
+        // in sort key order: the grid, then the cubes grouped by color, front to back.
+        // Cubes are drawn right away or queued for the instanced or indirect draw.
+        {
+            PROFILE_GPU_ZONE("models");
+            uint64_t stateKey = 0;
+            for (size_t i = 0; i < packet.commands.size(); ++i)
+            {
+                const DrawCommand& command = packet.commands[i];
+                const DrawRecord& record = packet.draws[command.record];
+
+                // the grid turns with the world
+                if (record.mesh == MESH_GRID)
+                {
+                    shaderProgram.setMat4(worldMatrixUniform, record.worldMatrix);
+                    shaderProgram.setVec3(colorUniform, record.color);
+                    grid.draw();
+                    continue;
+                }
+
+                switch (renderPath)
+                {
+                case RENDER_INSTANCED:
+                    instancedRenderer.add(record.worldMatrix, record.color);
+                    break;
+                case RENDER_INDIRECT:
+                    // one draw record per program, mesh and material, as with several meshes
+                    if (i > 0 && (command.key >> DRAW_KEY_DEPTH_BITS) != stateKey)
+                        indirectRenderer.endDraw();
+                    indirectRenderer.add(record.worldMatrix, record.color);
+                    break;
+                default:
+                    shaderProgram.setVec3(colorUniform, record.color);
+                    shaderProgram.setMat4(worldMatrixUniform, record.worldMatrix);
+                    cube.draw(packet.drawMode);
+                    break;
+                }
+                stateKey = command.key >> DRAW_KEY_DEPTH_BITS;
+            }
+        }
 #pragma endregion
 
-#pragma region gridAxis
-        glUniform3f(aColorLocation, 1.0f, 0.0f, 0.0f); // grid red
-        //x-axis - red
-        glm::mat4 axisMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(1.25f, 0.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(3.0f, 0.12f, 0.12f));
-        axisMatrix = worldRotationMatrix * axisMatrix;
-        worldMatrixLocation = glGetUniformLocation(shaderProgram, "worldMatrix");
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &axisMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-        //y-axis
-        glUniform3f(aColorLocation, 0.0f, 1.0f, 0.0f); // grid green
-        axisMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.25f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.12f, 3.0f, 0.12f));
-        axisMatrix = worldRotationMatrix * axisMatrix;
-        worldMatrixLocation = glGetUniformLocation(shaderProgram, "worldMatrix");
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &axisMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-        //z-axis
-        glUniform3f(aColorLocation, 1.0f, 1.0f, 0.0f); // grid yellow
-        axisMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.25f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.12f, 0.12f, 3.0f));
-        axisMatrix = worldRotationMatrix * axisMatrix;
-        worldMatrixLocation = glGetUniformLocation(shaderProgram, "worldMatrix");
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &axisMatrix[0][0]);
-        glDrawArrays(draw, 0, 36);
-#pragma endregion
+        if (renderPath == RENDER_INSTANCED)
+        {
+            PROFILE_GPU_ZONE("instanced draw");
+            instancedShaderProgram.use();
+            instancedRenderer.draw(packet.drawMode, cube.indexCount(), cube.indexType());
+            shaderProgram.use();
+        }
+        else if (renderPath == RENDER_INDIRECT)
+        {
+            PROFILE_GPU_ZONE("indirect draw");
+            indirectShaderProgram.use();
+            if (!indirectRenderer.draw(packet.drawMode, cube.indexCount(), cube.indexType()))
+            {
+                // the frame's objects don't fit in the streaming buffer, the main thread switches to direct draws
+                std::cerr << "Too many objects for the indirect path, back to direct draws" << std::endl;
+                indirectOverflowed = true;
+            }
+            shaderProgram.use();
+        }
 
+        // the finished frame is copied before it is swapped
+        for (size_t i = 0; i < packet.captures.size(); ++i)
+        {
+            PROFILE_ZONE("capture");
+            const CaptureRequest& request = packet.captures[i];
+            if (frameCapture.capture(captureSource, packet.captureWidth, packet.captureHeight, request.path, request.format) && request.screenshot)
+                std::cout << "Saving " << request.path << std::endl;
+        }
 
-        //dot to fix the grid problem of attaching to the last drawn point
-        glm::mat4 dot = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(worldAnglex), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(worldAngley), glm::vec3(0.0f, 1.0f, 0.0f));
-        glUniformMatrix4fv(worldMatrixLocation, 1, GL_FALSE, &dot[0][0]);
-        glDrawArrays(GL_POINTS, 0, 36);
+        // nothing more is streamed this frame, its region is fenced
+        streamBuffer.endFrame();
 
         // End Frame
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-        
-
-        // Handle inputs
-        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-            glfwSetWindowShouldClose(window, true);
-        glfwSetInputMode(window, GLFW_LOCK_KEY_MODS, GLFW_TRUE);
-
-        bool fastCam = glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
-        float currentCameraSpeed = (fastCam) ? cameraFastSpeed : cameraSpeed;
-
-        //Rotate model that is selected along the Y-axis 5 degrees per key press
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && !isPressedA) // rotate right 5 degrees
+        if (headless)
         {
-            isPressedA = true;
-
-            if (CModelIsOn)
-                CAnglex += rotationAngle;
-            else if (HModelIsOn)
-                HAnglex += rotationAngle;
-            else if (A1ModelIsOn)
-                A1Anglex += rotationAngle;
-            else if (M1ModelIsOn)
-                M1Anglex += rotationAngle;
-            else if (M2ModelIsOn)
-                M2Anglex += rotationAngle;
-            else if (A2ModelIsOn)
-                A2Anglex += rotationAngle;
+            // submit the frame like a swap would, without waiting for the GPU
+            {
+                PROFILE_ZONE("flush");
+                glFlush();
+            }
+            double flushTime = elapsedSeconds();
+            headlessFrameTimes.push_back(1000.0 * (flushTime - lastFlushTime));
+            lastFlushTime = flushTime;
+            if (options.report == NULL)
+                std::cout << "Frame " << headlessFrameTimes.size() << ": " << headlessFrameTimes.back() << " ms CPU" << std::endl;
         }
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && !isPressedD)
+        else
         {
-            isPressedD = true;
-
-            if (CModelIsOn)
-                CAnglex -= rotationAngle;
-            else if (HModelIsOn)
-                HAnglex -= rotationAngle;
-            else if (A1ModelIsOn)
-                A1Anglex -= rotationAngle;
-            else if (M1ModelIsOn)
-                M1Anglex -= rotationAngle;
-            else if (M2ModelIsOn)
-                M2Anglex -= rotationAngle;
-            else if (A2ModelIsOn)
-                A2Anglex -= rotationAngle;
+            PROFILE_ZONE("swap buffers");
+            glfwSwapBuffers(window);
         }
 
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_RELEASE && isPressedA)
+        // file names of captures allocate, and so do pixel buffers of the encoders
+        // that grow for a larger capture or an EXR: those frames are not checked
+        frameStats.allocations = packet.allocations + (int)(threadAllocationCount() - renderAllocations);
+        if (ALLOCATION_COUNTER_ENABLED && headless && headlessFrameTimes.size() > (size_t)HEADLESS_WARMUP_FRAMES
+            && packet.captures.empty() && !captureAllocated && frameStats.allocations > 0)
         {
-            isPressedA = false;
+            std::cerr << "ERROR::FRAME::ALLOCATIONS frame " << headlessFrameTimes.size() << " allocated "
+                << frameStats.allocations << " times" << std::endl;
+            ++allocatingFrames;
         }
 
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_RELEASE && isPressedD)
+        // --bench-scaling: the frames after the warm-up
+        if (options.report != NULL && headlessFrameTimes.size() > (size_t)HEADLESS_WARMUP_FRAMES)
         {
-            isPressedD = false;
+            options.report->frameTimes.push_back(headlessFrameTimes.back());
+            options.report->drawCalls += frameStats.drawCalls;
+            options.report->uniformUploads += frameStats.uniformUploads;
+            options.report->triangles += frameStats.trianglesSubmitted;
         }
 
-        if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT)) // rotate left by 5 degrees (continous rotation!)
+        lastFrameStats = frameStats;
+        statsTimer += packet.frameTime;
+        statsFrameCount++;
+        if (statsTimer >= 1.0f)
         {
-
-            if (CModelIsOn)
-                CAnglex += CAnglex + rotationSpeed * dt;
-            else if (HModelIsOn)
-                HAnglex += CAnglex + rotationSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Anglex += A1Anglex + rotationSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Anglex += M1Anglex + rotationSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Anglex += M2Anglex + rotationSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Anglex += A2Anglex + rotationSpeed * dt;
+            if (packet.showFrameStats)
+            {
+                std::cout << "[" << renderPathNames[renderPath] << "] ";
+                printFrameStats(std::cout, lastFrameStats, 1000.0f * statsTimer / statsFrameCount);
+            }
+            statsTimer = 0.0f;
+            statsFrameCount = 0;
         }
 
-        if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT)) // rotate right by 5 degrees (continous rotation!)
+        if (packet.writeProfile)
         {
-            if (CModelIsOn)
-                CAnglex = CAnglex - rotationSpeed * dt;
-            else if (HModelIsOn)
-                HAnglex = HAnglex - rotationSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Anglex = A1Anglex - rotationSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Anglex = M1Anglex - rotationSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Anglex = M2Anglex - rotationSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Anglex = A2Anglex - rotationSpeed * dt;
+            writeProfile();
         }
+    };
 
-        //Rotate model that is selected along the X-axis 5 degrees per key press (continuously)
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    // The GL context moves to the render thread for the whole loop; the main
+    // thread keeps the window events, the simulation and the culling, and
+    // hands every frame over as a packet. The triple buffer lets it build
+    // frame N+1 while frame N is submitted, it waits when it gets further ahead.
+    TripleBuffer<FramePacket> framePackets;
+    auto setContextCurrent = [&](bool current) -> bool
+    {
+        if (headless)
         {
-            if (CModelIsOn)
-                CAngley = CAngley + rotationSpeed * dt;
-            else if (HModelIsOn)
-                HAngley = HAngley + rotationSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Angley = A1Angley + rotationSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Angley = M1Angley + rotationSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Angley = M2Angley + rotationSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Angley = A2Angley + rotationSpeed * dt;
+            if (!current)
+            {
+                offscreenContext.release();
+                return true;
+            }
+            return offscreenContext.makeCurrent();
         }
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+        glfwMakeContextCurrent(current ? window : NULL);
+        return true;
+    };
+    setContextCurrent(false);
+    std::thread renderThread([&]()
+    {
+        // without a context the packets are still taken, so that the main thread can quit
+        bool contextCurrent = setContextCurrent(true);
+        lastFlushTime = elapsedSeconds();
+        for (;;)
         {
-            if (CModelIsOn)
-                CAngley = CAngley - rotationSpeed * dt;
-            else if (HModelIsOn)
-                HAngley = HAngley - rotationSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Angley = A1Angley - rotationSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Angley = M1Angley - rotationSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Angley = M2Angley - rotationSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Angley = A2Angley - rotationSpeed * dt;
+            {
+                PROFILE_ZONE("wait for packet");
+                waitUntil([&]() { return framePackets.acquire(); });
+            }
+            const FramePacket& packet = framePackets.readSlot();
+            if (packet.quit)
+                break;
+            if (contextCurrent)
+                renderFrame(packet);
         }
+        setContextCurrent(false);
+    });
 
-        //move selected model with shift + a,d,w,s
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)   // move model left 
-        {
-            if (CModelIsOn)
-                CMovex = CMovex - modelMovementSpeed * dt;
-            else if (HModelIsOn)
-                HMovex = HMovex - modelMovementSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Movex = A1Movex - modelMovementSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Movex = M1Movex - modelMovementSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Movex = M2Movex - modelMovementSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Movex = A2Movex - modelMovementSpeed * dt;
-        }
+    // Entering Main Loop
+    uint64_t publishedAllocations = threadAllocationCount();
+    while (headless ? packetCount < headlessFrames : !glfwWindowShouldClose(window))
+    {
+        PROFILE_ZONE("update");
+        double frameStart = elapsedSeconds();
+        FramePacket& packet = framePackets.writeSlot();
+
+        float frameTime = elapsedSeconds() - lastFrameTime;
+        lastFrameTime += frameTime;
 
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) // move model up
+        // run the simulation steps due since the last frame, then draw the
+        // state between the last two steps that matches the current time
         {
-            if (CModelIsOn)
-                CMovey = CMovey + modelMovementSpeed * dt;
-            else if (HModelIsOn)
-                HMovey = HMovey + modelMovementSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Movey = A1Movey + modelMovementSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Movey = M1Movey + modelMovementSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Movey = M2Movey + modelMovementSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Movey = A2Movey + modelMovementSpeed * dt;
+            PROFILE_ZONE("simulation");
+            simulationTime += std::min(frameTime, maxFrameTime);
+            while (simulationTime >= simulationStep)
+            {
+                previousState = state;
+                simulate(simulationStep);
+                simulationTime -= simulationStep;
+            }
+            interpolateState(previousState, state, simulationTime / simulationStep, renderState);
         }
 
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)   // move model down
+#pragma region World
+        // only transforms that changed since the last frame are recomposed, with their parts
         {
-            if (CModelIsOn)
-                CMovey = CMovey - modelMovementSpeed * dt;
-            else if (HModelIsOn)
-                HMovey = HMovey - modelMovementSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Movey = A1Movey - modelMovementSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Movey = M1Movey - modelMovementSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Movey = M2Movey - modelMovementSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Movey = A2Movey - modelMovementSpeed * dt;
+            PROFILE_ZONE("transforms");
+            transforms.setTransform(worldNode, glm::vec3(0.0f), glm::vec3(renderState.worldAnglex, renderState.worldAngley, 0.0f), glm::vec3(1.0f));
+            for (unsigned int i = 0; i < scene.modelCount(); ++i)
+            {
+                const ModelState& model = renderState.models[i];
+                transforms.setTransform(modelNodes[i],
+                    scene.model(i).position + glm::vec3(model.movex, model.movey, 0.0f),
+                    glm::vec3(model.angley, model.anglex, 0.0f),
+                    glm::vec3(model.scale, model.scale, model.scale));
+            }
+            packet.matricesRecomputed = transforms.update(&jobs);
         }
+#pragma endregion
 
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)     // move model right
+        // camera matrices changed by the inputs of the last frame, if any
+        viewMatrix = lookAt(renderState.cameraPosition, renderState.cameraPosition + cameraLookAt, cameraUp);
+        if (options.cameraPath)
         {
-            if (CModelIsOn)
-                CMovex = CMovex + modelMovementSpeed * dt;
-            else if (HModelIsOn)
-                HMovex = HMovex + modelMovementSpeed * dt;
-            else if (A1ModelIsOn)
-                A1Movex = A1Movex + modelMovementSpeed * dt;
-            else if (M1ModelIsOn)
-                M1Movex = M1Movex + modelMovementSpeed * dt;
-            else if (M2ModelIsOn)
-                M2Movex = M2Movex + modelMovementSpeed * dt;
-            else if (A2ModelIsOn)
-                A2Movex = A2Movex + modelMovementSpeed * dt;
+            // one turn over the run, 15 units away from the center and 5 above it
+            float angle = 6.2831853f * packetCount / std::max(headlessFrames, 1);
+            renderState.cameraPosition = cameraPathCenter + glm::vec3(15.0f * sinf(angle), 5.0f, 15.0f * cosf(angle));
+            viewMatrix = lookAt(renderState.cameraPosition, cameraPathCenter, glm::vec3(0.0f, 1.0f, 0.0f));
         }
 
-        //scale model up and down with shift + j,u. one change per key press
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS && !isPressedU) {
-
-            isPressedU = true;
-
-            if (CModelIsOn)
-                CScale += 0.05;
-            else if (HModelIsOn)
-                HScale += 0.05;
-            else if (A1ModelIsOn)
-                A1Scale += 0.05;
-            else if (M1ModelIsOn)
-                M1Scale += 0.05;
-            else if (M2ModelIsOn)
-                M2Scale += 0.05;
-            else if (A2ModelIsOn)
-                A2Scale += 0.05;
-        }
+        // Models outside the view are skipped with all their parts, parts are
+        // only tested inside visible models
+        packet.objectsTested = 0;
+        packet.objectsCulled = 0;
+        if (packet.matricesRecomputed > 0)
+            boundsDirty = true;
+        if (useCulling)
+        {
+            PROFILE_ZONE("culling");
+            if (boundsDirty)
+            {
+                boundsDirty = false;
+                // parts are unit cubes, a model's box is the union of its part boxes
+                jobs.parallelFor(0, scene.modelCount(), 64, [&](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const SceneModel& model = scene.model((unsigned int)i);
+                        glm::vec3 lower(FLT_MAX), upper(-FLT_MAX);
+                        for (unsigned int j = model.firstPart; j < model.firstPart + model.partCount; ++j)
+                        {
+                            glm::vec3 center, extent;
+                            transformBoundingBox(transforms.worldMatrix(partNodes[j]), glm::vec3(0.0f), glm::vec3(0.5f), center, extent);
+                            partBounds.set(j, center, extent);
+                            lower = glm::min(lower, center - extent);
+                            upper = glm::max(upper, center + extent);
+                        }
+                        if (model.partCount > 0)
+                            modelBounds.set(i, 0.5f * (lower + upper), 0.5f * (upper - lower));
+                    }
+                });
+            }
 
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS && !isPressedJ) {
-
-            isPressedJ = true;
-
-            if (CModelIsOn)
-                CScale -= 0.05;
-            else if (HModelIsOn)
-                HScale -= 0.05;
-            else if (A1ModelIsOn)
-                A1Scale -= 0.05;
-            else if (M1ModelIsOn)
-                M1Scale -= 0.05;
-            else if (M2ModelIsOn)
-                M2Scale -= 0.05;
-            else if (A2ModelIsOn)
-                A2Scale -= 0.05;
+            Frustum frustum = Frustum::fromMatrix(projectionMatrix * viewMatrix);
+            size_t visibleModels = modelBounds.cull(frustum, 0, scene.modelCount(), &modelVisible[0]);
+            std::atomic<int> partsTested(0), partsCulled(0);
+            jobs.parallelFor(0, scene.modelCount(), 64, [&](size_t begin, size_t end)
+            {
+                int tested = 0, culled = 0;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const SceneModel& model = scene.model((unsigned int)i);
+                    if (!modelVisible[i] || model.partCount == 0)
+                        continue;
+                    size_t visibleParts = partBounds.cull(frustum, model.firstPart, model.firstPart + model.partCount, &partVisible[model.firstPart]);
+                    tested += model.partCount;
+                    culled += (int)(model.partCount - visibleParts);
+                }
+                partsTested += tested;
+                partsCulled += culled;
+            });
+            packet.objectsTested = (int)scene.modelCount() + partsTested.load();
+            packet.objectsCulled = (int)(scene.modelCount() - visibleModels) + partsCulled.load();
         }
 
-        if (glfwGetKey(window, GLFW_KEY_U) == GLFW_RELEASE && isPressedU)
+#pragma region Models
+        // C H A M M A and the axes, as described in the scene file: a draw
+        // record and a sort key for the grid and every visible part
         {
-            isPressedU = false;
+            PROFILE_ZONE("draw list");
+            // at most the grid and every part
+            packet.arena.reset();
+            packet.draws = packet.arena.allocateArray<DrawRecord>(scene.partCount() + 1);
+            packet.drawCount = 0;
+            packet.commands.reset(packet.arena, scene.partCount() + 1);
+
+            DrawRecord& gridRecord = packet.draws[packet.drawCount];
+            gridRecord.worldMatrix = transforms.worldMatrix(worldNode);
+            gridRecord.color = glm::vec3(0.0f, 0.0f, 0.0f);
+            gridRecord.mesh = MESH_GRID;
+            packet.commands.add(makeDrawKey(PASS_OPAQUE, PROGRAM_COLOR, MESH_GRID, 0, 0.0f), packet.drawCount++);
+
+            const float farPlane = 100.0f;
+            for (unsigned int i = 0; i < scene.modelCount(); ++i)
+            {
+                const SceneModel& model = scene.model(i);
+                if (useCulling && !modelVisible[i])
+                    continue;
+                for (unsigned int j = model.firstPart; j < model.firstPart + model.partCount; ++j)
+                {
+                    if (useCulling && !partVisible[j])
+                        continue;
+                    // the cube positions are quantized, the world matrix brings them back to unit size
+                    const glm::mat4& partMatrix = transforms.worldMatrix(partNodes[j]);
+                    DrawRecord& record = packet.draws[packet.drawCount];
+                    record.worldMatrix = partMatrix * cube.dequantization();
+                    record.color = scene.part(j).color;
+                    record.mesh = MESH_CUBE;
+
+                    // view distance of the cube's center, for the front to back order
+                    float depth = -(viewMatrix * partMatrix[3]).z / farPlane;
+                    packet.commands.add(makeDrawKey(PASS_OPAQUE, PROGRAM_COLOR, MESH_CUBE, partMaterials[j], depth), packet.drawCount++);
+                }
+            }
         }
-
-        if (glfwGetKey(window, GLFW_KEY_J) == GLFW_RELEASE && isPressedJ)
         {
-            isPressedJ = false;
+            PROFILE_ZONE("sort");
+            packet.commands.sort();
         }
+#pragma endregion
 
-        // camera movements
-
-        if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) // move camera to the left
+        // captures of the frame, made by the render thread once it is drawn, of
+        // the framebuffer's actual size: resized window, or HiDPI display
+        packet.captures.clear();
+        if (headless)
         {
-            cameraPosition.x -= currentCameraSpeed * dt * sinf(camx);
-            cameraPosition.z -= currentCameraSpeed * dt * cosf(camx);
-
+            packet.captureWidth = offscreenFramebuffer.width();
+            packet.captureHeight = offscreenFramebuffer.height();
         }
-
-        if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) // move camera to the right
+        else
         {
-            cameraPosition.x += currentCameraSpeed * dt * sinf(camx);
-            cameraPosition.z += currentCameraSpeed * dt * cosf(camx);
+            glfwGetFramebufferSize(window, &packet.captureWidth, &packet.captureHeight);
         }
-
-        if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) // move camera backward
+        if (screenshotRequested)
         {
-            cameraPosition.z += currentCameraSpeed * dt * sinf(camx);
-            cameraPosition.x -= currentCameraSpeed * dt * cosf(camx);
+            CaptureRequest request;
+            request.path = "screenshot-" + std::to_string(++screenshotCount) + captureFileExtension(screenshotFormat);
+            request.format = screenshotFormat;
+            request.screenshot = true;
+            packet.captures.push_back(request);
+            screenshotRequested = false;
         }
-
-        if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS && !glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) // move camera forward
+        if (recording)
         {
-            cameraPosition.z -= currentCameraSpeed * dt * sinf(camx);
-            cameraPosition.x += currentCameraSpeed * dt * cosf(camx);
+            recordingTime += frameTime;
+            if (recordingTime >= recordingInterval)
+            {
+                // at most one frame per rendered frame, time is lost when rendering is slower than 60 fps
+                recordingTime = std::min(recordingTime - recordingInterval, recordingInterval);
+                char frameNumber[16];
+                snprintf(frameNumber, sizeof(frameNumber), "%06d", recordedFrames++);
+                CaptureRequest request;
+                request.path = "sequence" + std::to_string(recordingCount) + "-" + frameNumber + captureFileExtension(CAPTURE_PNG);
+                request.format = CAPTURE_PNG;
+                request.screenshot = false;
+                packet.captures.push_back(request);
+            }
         }
 
-        //moving camera up ad down with [ , ]
-        if (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS) // move camera up
+        packet.quit = false;
+        packet.frameTime = frameTime;
+        packet.time = (float)frameStart;
+        packet.viewMatrix = viewMatrix;
+        packet.projectionMatrix = projectionMatrix;
+        packet.cameraPosition = renderState.cameraPosition;
+        packet.renderPath = renderPath;
+        packet.drawMode = draw;
+        packet.showFrameStats = showFrameStats;
+        packet.writeProfile = profileRequested;
+        profileRequested = false;
+
+        // hand the frame over once the render thread took the previous one
         {
-            cameraPosition.y += currentCameraSpeed * dt;
+            PROFILE_ZONE("wait for render thread");
+            waitUntil([&]() { return !framePackets.isPending(); });
         }
+        // the main thread's allocations since the last packet, its inputs included
+        packet.allocations = (int)(threadAllocationCount() - publishedAllocations);
+        publishedAllocations = threadAllocationCount();
+        framePackets.publish();
+        ++packetCount;
 
-        if (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS) // move camera down
+        if (!headless)
         {
-            cameraPosition.y -= currentCameraSpeed * dt;
+            PROFILE_ZONE("poll events");
+            input.poll();
         }
 
-        // switching between models with 1-5, camera focuses on model
-
-        if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) // flag C model
-        {
-            //reseting camera and world angle
-            //cam x angle
-            camx = 1.57;
-            tempcamx = 1.57;
-            //cam y angle
-            camy = 0;
-            tempcamy = 0;
-
-            worldAnglex = 0;
-            worldAnglex = 0;
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            CModelIsOn = true;
-            HModelIsOn = false;
-            A1ModelIsOn = false;
-            M1ModelIsOn = false;
-            M2ModelIsOn = false;
-            A2ModelIsOn = false;
-
-            //zoom reset
-            feild_of_vew = 70.0f;
-            temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
-                1024.0f / 768.0f,  // aspect ratio
-                0.01f, 100.0f);   // near and far (near > 0)
+        if (indirectOverflowed.exchange(false) && renderPath == RENDER_INDIRECT)
+            renderPath = RENDER_DIRECT;
 
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
-            // Camera parameters for view transform
-            cameraPosition = glm::vec3(-5.2f, 1.0f, -15.5f);
-            cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
+        // Handle inputs, the actions were updated from the window events by input.poll()
+        PROFILE_ZONE("input");
+        if (input.wasPressed(ACTION_QUIT))
+            glfwSetWindowShouldClose(window, true);
 
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+        //switch render path with F1, toggle frame stats with F2
+        if (input.wasPressed(ACTION_TOGGLE_INSTANCING))
+        {
+            do
+                renderPath = (RenderPath)((renderPath + 1) % RENDER_PATH_COUNT);
+            while (!renderPathSupported[renderPath]);
+            std::cout << "Render path: " << renderPathNames[renderPath] << std::endl;
         }
-
-        if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) // flag H model
+        if (input.wasPressed(ACTION_TOGGLE_FRAME_STATS))
         {
-            //reseting camera and world angle
-            //cam x angle
-            camx = 1.57;
-            tempcamx = 1.57;
-            //cam y angle
-            camy = 0;
-            tempcamy = 0;
-
-            worldAnglex = 0;
-            worldAnglex = 0;
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            CModelIsOn = false;
-            HModelIsOn = true;
-            A1ModelIsOn = false;
-            M1ModelIsOn = false;
-            M2ModelIsOn = false;
-            A2ModelIsOn = false;
-
-            //zoom reset
-            feild_of_vew = 70.0f;
-            temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
-                1024.0f / 768.0f,  // aspect ratio
-                0.01f, 100.0f);   // near and far (near > 0)
-
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
-            // Camera parameters for view transform
-            cameraPosition = glm::vec3(-3.3f, 1.0f, -15.5f);
-            cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
-
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+            showFrameStats = !showFrameStats;
         }
-
-        if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) // flag A model
+        if (input.wasPressed(ACTION_TOGGLE_CULLING))
         {
-            //reseting camera and world angle
-            //cam x angle
-            camx = 1.57;
-            tempcamx = 1.57;
-            //cam y angle
-            camy = 0;
-            tempcamy = 0;
-
-            worldAnglex = 0;
-            worldAnglex = 0;
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            CModelIsOn = false;
-            HModelIsOn = false;
-            A1ModelIsOn = true;
-            M1ModelIsOn = false;
-            M2ModelIsOn = false;
-            A2ModelIsOn = false;
-
-            //zoom reset
-            feild_of_vew = 70.0f;
-            temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
-                1024.0f / 768.0f,  // aspect ratio
-                0.01f, 100.0f);   // near and far (near > 0)
-
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
-            // Camera parameters for view transform
-            cameraPosition = glm::vec3(-1.0f, 1.0f, -15.5f);
-            cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
-
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+            useCulling = !useCulling;
+            std::cout << "Frustum culling: " << (useCulling ? "on" : "off") << std::endl;
         }
-        if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS) // flag M model
+        if (input.wasPressed(ACTION_WRITE_PROFILE))
         {
-            //reseting camera and world angle
-            //cam x angle
-            camx = 1.57;
-            tempcamx = 1.57;
-            //cam y angle
-            camy = 0;
-            tempcamy = 0;
-
-            worldAnglex = 0;
-            worldAnglex = 0;
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            CModelIsOn = false;
-            HModelIsOn = false;
-            A1ModelIsOn = false;
-            M1ModelIsOn = true;
-            M2ModelIsOn = false;
-            A2ModelIsOn = false;
-
-            //zoom reset
-            feild_of_vew = 70.0f;
-            temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
-                1024.0f / 768.0f,  // aspect ratio
-                0.01f, 100.0f);   // near and far (near > 0)
-
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
-            // Camera parameters for view transform
-            cameraPosition = glm::vec3(1.5f, 1.0f, -15.5f);
-            cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
-
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+            profileRequested = true;
         }
 
-        if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS) // flag M model
+        //screenshot with F12 (PNG) or shift + F12 (EXR), start and stop a sequence with F11
+        if (input.wasPressed(ACTION_SCREENSHOT) || input.wasPressed(ACTION_SCREENSHOT_EXR))
         {
-            //reseting camera and world angle
-            //cam x angle
-            camx = 1.57;
-            tempcamx = 1.57;
-            //cam y angle
-            camy = 0;
-            tempcamy = 0;
-
-            worldAnglex = 0;
-            worldAnglex = 0;
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            CModelIsOn = false;
-            HModelIsOn = false;
-            A1ModelIsOn = false;
-            M1ModelIsOn = false;
-            M2ModelIsOn = true;
-            A2ModelIsOn = false;
-
-            //zoom reset
-            feild_of_vew = 70.0f;
-            temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
-                1024.0f / 768.0f,  // aspect ratio
-                0.01f, 100.0f);   // near and far (near > 0)
-
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
-            // Camera parameters for view transform
-            cameraPosition = glm::vec3(4.0f, 1.0f, -15.5f);
-            cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
-            cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
+            screenshotRequested = true;
+            screenshotFormat = input.wasPressed(ACTION_SCREENSHOT_EXR) ? CAPTURE_EXR : CAPTURE_PNG;
+        }
+        if (input.wasPressed(ACTION_TOGGLE_RECORDING))
+        {
+            recording = !recording;
+            if (recording)
+            {
+                recordingTime = recordingInterval;
+                recordedFrames = 0;
+                droppedBeforeRecording = frameCapture.droppedFrames();
+                std::cout << "Recording sequence" << ++recordingCount << "-*" << captureFileExtension(CAPTURE_PNG) << std::endl;
+            }
+            else
+            {
+                std::cout << "Stopped recording: " << recordedFrames << " frames, "
+                    << frameCapture.droppedFrames() - droppedBeforeRecording << " dropped" << std::endl;
+            }
+        }
 
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+        //state of the selected model, if any, held keys are handled by simulate()
+        ModelState* selected = (selectedModel >= 0) ? &state.models[selectedModel] : NULL;
+        if (selected)
+        {
+            //rotate along the Y-axis 5 degrees per key press
+            if (input.wasPressed(ACTION_MODEL_STEP_LEFT))
+                selected->anglex += rotationAngle;
+            if (input.wasPressed(ACTION_MODEL_STEP_RIGHT))
+                selected->anglex -= rotationAngle;
+
+            //scale with shift + u,j, one change per key press
+            if (input.wasPressed(ACTION_MODEL_SCALE_UP))
+                selected->scale += 0.05;
+            if (input.wasPressed(ACTION_MODEL_SCALE_DOWN))
+                selected->scale -= 0.05;
         }
 
-        if (glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS) // flag A model
+        // switching between models with 1-9, camera focuses on model
+        bool jumped = false;
+        for (int n = 0; n < 9; ++n)
         {
+            int modelIndex = scene.selectableModel(n);
+            if (modelIndex < 0 || !input.wasPressed((InputAction)(ACTION_SELECT_MODEL_1 + n)))
+                continue;
+
+            //reseting camera and world angle
             //cam x angle
             camx = 1.57;
             tempcamx = 1.57;
@@ -1146,82 +1386,41 @@ int main(int argc, char* argv[])
             camy = 0;
             tempcamy = 0;
 
-            worldAnglex = 0;
-            worldAnglex = 0;
+            state.worldAnglex = 0;
+            state.worldAngley = 0;
             cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-            CModelIsOn = false;
-            HModelIsOn = false;
-            A1ModelIsOn = false;
-            M1ModelIsOn = false;
-            M2ModelIsOn = false;
-            A2ModelIsOn = true;
+            selectedModel = modelIndex;
 
             //zoom reset
             feild_of_vew = 70.0f;
             temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
+            projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
                 1024.0f / 768.0f,  // aspect ratio
                 0.01f, 100.0f);   // near and far (near > 0)
 
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
             // Camera parameters for view transform
-            cameraPosition = glm::vec3(6.0f, 1.0f, -15.5f);
+            state.cameraPosition = scene.model(modelIndex).camera;
+            jumped = true;
             cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
             cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
-
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
         }
 
-
-        if (glfwGetKey(window, GLFW_KEY_0) == GLFW_PRESS) // unflag all models
+        if (input.wasPressed(ACTION_DESELECT_MODEL)) // unflag all models
         {
-            CModelIsOn = false;
-            HModelIsOn = false;
-            A1ModelIsOn = false;
-            M1ModelIsOn = false;
-            M2ModelIsOn = false;
-            A2ModelIsOn = false;
+            selectedModel = -1;
         }
 
         //changing between the points, lines and triangles functionality
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
-        {
+        if (input.wasPressed(ACTION_DRAW_LINES))
             draw = GL_LINE_STRIP;
-        }
-
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
-        {
+        if (input.wasPressed(ACTION_DRAW_POINTS))
             draw = GL_POINTS;
-        }
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
-        {
+        if (input.wasPressed(ACTION_DRAW_TRIANGLES))
             draw = GL_TRIANGLES;
-        }
-
-        //Arrow keys for world rotation
-        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
-        {
-            worldAnglex = (worldAnglex + rotationSpeed * dt); // angles in degrees, but glm expects radians (conversion below)
-        }
-        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-        {
-            worldAngley = (worldAngley + rotationSpeed * dt); // angles in degrees, but glm expects radians (conversion below)
-        }if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
-        {
-            worldAngley = (worldAngley - rotationSpeed * dt); // angles in degrees, but glm expects radians (conversion below)
-        }if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
-        {
-            worldAnglex = (worldAnglex - rotationSpeed * dt); // angles in degrees, but glm expects radians (conversion below)
-        }
 
         //reseting the camera with the home button
-        if (glfwGetKey(window, GLFW_KEY_HOME) == GLFW_PRESS)
+        if (input.wasPressed(ACTION_WORLD_RESET))
         {
             //cam x angle
             camx = 1.57;
@@ -1230,82 +1429,122 @@ int main(int argc, char* argv[])
             camy = 0;
             tempcamy = 0;
             // Camera parameters for view transform
-            worldAnglex = 0;
-            worldAngley = 0;
+            state.worldAnglex = 0;
+            state.worldAngley = 0;
             cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
             //zoom reset
             feild_of_vew = 70.0f;
             temp_feild_of_vew = 70.0f;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
+            projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
                 1024.0f / 768.0f,  // aspect ratio
                 0.01f, 100.0f);   // near and far (near > 0)
 
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
             // Camera parameters for view transform
-            cameraPosition = glm::vec3(0.6f, 1.0f, 10.0f);
+            state.cameraPosition = glm::vec3(0.6f, 1.0f, 10.0f);
             cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
             cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+            jumped = true;
         }
         //reseting the camera only with O
-        if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS)
+        if (input.wasPressed(ACTION_CAMERA_RESET))
         {
             // Camera parameters for view transform
-            cameraPosition = glm::vec3(0.6f, 1.0f, 10.0f);
+            state.cameraPosition = glm::vec3(0.6f, 1.0f, 10.0f);
             cameraLookAt = glm::vec3(0.0f, 0.0f, -1.0f);
             cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
-
-            GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-            glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+            jumped = true;
         }
 
-
         //using mouse for tilting, panning and zooming
-        if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
-            camy = tempcamy + (ypos - tempypos) / 500;
-            camx = tempcamx + (xpos - tempxpos) / 500;
+        if (input.isDown(ACTION_CAMERA_PAN)) {
+            camy = tempcamy + (input.cursorY() - tempypos) / 500;
+            camx = tempcamx + (input.cursorX() - tempxpos) / 500;
             cameraLookAt = glm::vec3(cosf(camy) * cosf(camx)
                 , sinf(camy)
                 , -cosf(camy) * sinf(camx));
-            //tempxpos = xpos;
         }
-        else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
+        else if (input.isDown(ACTION_CAMERA_ZOOM)) {
+            double ypos = input.cursorY();
             if (temp_feild_of_vew + ((ypos - tempypos) / 100) < 70.0f && temp_feild_of_vew + ((ypos - tempypos) / 100) > 69.2f) {
                 feild_of_vew = temp_feild_of_vew + ((ypos - tempypos) / 100);
             }
 
-            //tempxpos = xpos;
-            glm::mat4 projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
+            projectionMatrix = glm::perspective(feild_of_vew,            // field of view in degrees
                 1024.0f / 768.0f,  // aspect ratio
                 0.01f, 100.0f);   // near and far (near > 0)
-
-            GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projectionMatrix");
-            glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projectionMatrix[0][0]);
-
-
         }
         else {
-            glfwGetCursorPos(window, &tempxpos, &tempypos);
+            tempxpos = input.cursorX();
+            tempypos = input.cursorY();
             tempcamx = camx;
             tempcamy = camy;
             temp_feild_of_vew = feild_of_vew;
         }
 
-        glm::mat4 viewMatrix = lookAt(cameraPosition, cameraPosition + cameraLookAt, cameraUp);
+        // selections and resets jump, they are not interpolated from the previous step
+        if (jumped)
+            previousState = state;
+    }
+
+    // the render thread draws the packets already handed over, then gives the context back
+    waitUntil([&]() { return !framePackets.isPending(); });
+    framePackets.writeSlot().quit = true;
+    framePackets.publish();
+    renderThread.join();
+    setContextCurrent(true);
+
+    // pending captures are written before the context goes away
+    frameCapture.destroy();
+    cameraUniforms.destroy();
+    const StreamBufferStats& streamStats = streamBuffer.stats();
+    std::cout << "Streaming buffer: " << streamStats.peakFrameBytes << " bytes per frame at most, "
+        << streamStats.stalls << " stalls (" << 1000.0 * streamStats.stallSeconds << " ms), "
+        << streamStats.overflows << " overflows" << std::endl;
+    streamBuffer.destroy();
+    if (recording)
+    {
+        std::cout << "Stopped recording: " << recordedFrames << " frames, "
+            << frameCapture.droppedFrames() - droppedBeforeRecording << " dropped" << std::endl;
+    }
+
+    // the zones recorded since the last F3, and the GPU results still in flight
+    PROFILE_GPU_SHUTDOWN();
+#if PROFILER_ENABLED
+    writeProfile();
+#endif
 
-        GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "viewMatrix");
-        glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &viewMatrix[0][0]);
+    if (headless && !headlessFrameTimes.empty())
+    {
+        // the last frames may still be rendering, they are not part of the CPU times
+        glFinish();
+        double totalTime = 0.0;
+        for (size_t i = 0; i < headlessFrameTimes.size(); ++i)
+            totalTime += headlessFrameTimes[i];
+        float finalFrameTime = (float)headlessFrameTimes.back();
+        std::sort(headlessFrameTimes.begin(), headlessFrameTimes.end());
+        std::cout << "Rendered " << headlessFrameTimes.size() << " frames offscreen: "
+            << totalTime / headlessFrameTimes.size() << " ms CPU on average, "
+            << headlessFrameTimes.front() << " min, "
+            << headlessFrameTimes[headlessFrameTimes.size() / 2] << " median, "
+            << headlessFrameTimes.back() << " max" << std::endl;
+        std::cout << "Last frame: ";
+        printFrameStats(std::cout, lastFrameStats, finalFrameTime);
     }
 
     // Shutdown GLFW
     glfwTerminate();
 
+    if (options.report != NULL)
+    {
+        options.report->parts = scene.partCount();
+        options.report->renderPathUsed = renderPathNames[renderPath];
+        options.report->allocatingFrames = allocatingFrames;
+    }
+
+    if (allocatingFrames > 0)
+    {
+        std::cerr << "ERROR::FRAME::ALLOCATIONS " << allocatingFrames << " frames allocated after the warm-up" << std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #version 330 core
 in vec3 vertexColor;
+
 out vec4 FragColor;
+
 void main()
 {
-FragColor = vec4(vertexColor.r, vertexColor.g, vertexColor.b, 1.0f);
-};
\ No newline at end of file
+    FragColor = vec4(vertexColor.r, vertexColor.g, vertexColor.b, 1.0f);
+}
@@ -0,0 +1,38 @@
+#version 430 core
+// Same as InstancedVertexShader.glsl, but the world matrix and color of each cube come
+// from a storage buffer so that all the draw records of a frame go out in one
+// glMultiDrawElementsIndirect call. objectIndex is 0, 1, 2... per instance, offset by
+// the base instance of the draw record.
+layout (location = 0) in vec3 aPos;
+layout (location = 8) in uint objectIndex;
+
+struct ObjectData
+{
+    mat4 worldMatrix;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Objects
+{
+    ObjectData objects[];
+};
+
+// Camera of the frame, shared by all programs (CameraUniforms.h)
+layout (std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec3 cameraPosition;
+    float time;
+};
+
+out vec3 vertexColor;
+
+void main()
+{
+    ObjectData object = objects[objectIndex];
+    vertexColor = object.color.rgb;
+    mat4 modelViewProjection = viewProjectionMatrix * object.worldMatrix;
+    gl_Position = modelViewProjection * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 330 core
+// Same as VertexShader.glsl, but the world matrix and color of each cube come from
+// per-instance attributes so a whole frame of cubes can be drawn in one call
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in mat4 instanceWorldMatrix;
+layout (location = 6) in vec3 instanceColor;
+
+
+// Camera of the frame, shared by all programs (CameraUniforms.h)
+layout (std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec3 cameraPosition;
+    float time;
+};
+
+out vec3 vertexColor;
+
+void main()
+{
+    vertexColor = instanceColor;
+    mat4 modelViewProjection = viewProjectionMatrix * instanceWorldMatrix;
+    gl_Position = modelViewProjection * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+}
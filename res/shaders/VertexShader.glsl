@@ -1,13 +1,24 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
+
+uniform vec3 aColor = vec3(1.0f, 1.0f, 1.0f);
 uniform mat4 worldMatrix;
-uniform mat4 viewMatrix = mat4(1.0);
-uniform mat4 projectionMatrix = mat4(1.0);
+
+// Camera of the frame, shared by all programs (CameraUniforms.h)
+layout (std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec3 cameraPosition;
+    float time;
+};
+
 out vec3 vertexColor;
+
 void main()
 {
-vertexColor = aColor;
-mat4 modelViewProjection = projectionMatrix * viewMatrix * worldMatrix;
-gl_Position = modelViewProjection * vec4(aPos.x, aPos.y, aPos.z, 1.0);
-};
\ No newline at end of file
+    vertexColor = aColor;
+    mat4 modelViewProjection = viewProjectionMatrix * worldMatrix;
+    gl_Position = modelViewProjection * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+}